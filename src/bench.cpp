@@ -0,0 +1,110 @@
+/*
+
+This program benchmarks one variant of the solver, such as a different table
+replacement policy. Every test suite for the board size is solved, and the nodes
+searched and time taken are printed for each suite. Build and run it for every
+variant with:
+
+    cmake --build . --target bench
+
+The first argument limits the number of positions solved from each suite.
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "solver/position.h"
+#include "solver/replacement.h"
+#include "solver/settings.h"
+#include "solver/solver.h"
+#include "solver/util/suite.h"
+
+// The name of the variant is set by the build.
+#ifndef C4_BENCH_VARIANT
+#define C4_BENCH_VARIANT "default"
+#endif
+
+static inline constexpr int DEFAULT_POSITIONS_PER_SUITE = 100;
+
+static std::vector<std::filesystem::path> find_suites() {
+    std::filesystem::path directory = std::filesystem::path("tst") / "data"
+        / (std::to_string(BOARD_WIDTH) + "x" + std::to_string(BOARD_HEIGHT));
+
+    std::vector<std::filesystem::path> suites;
+    if (std::filesystem::is_directory(directory)) {
+        for (const auto &file : std::filesystem::directory_iterator(directory)) {
+            suites.push_back(file.path());
+        }
+    }
+
+    std::sort(suites.begin(), suites.end());
+    return suites;
+}
+
+static bool run_suite(Solver &solver, const std::filesystem::path &suite, int max_positions) {
+    std::vector<SuitePosition> positions = read_suite(suite, max_positions);
+    if (positions.empty()) {
+        std::cerr << "Failed to read the test suite " << suite << "." << std::endl;
+        return false;
+    }
+
+    // Each suite starts with an empty table, so suites do not depend on the order they run in.
+    solver.clear_state();
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    for (const SuitePosition &position : positions) {
+        int score = solver.solve_strong(position.pos);
+        if (score != position.score) {
+            std::cerr << "Error: position " << position.moves << " has score " << position.score
+                      << ", but the solver returned " << score << "." << std::endl;
+            return false;
+        }
+    }
+
+    auto end_time = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end_time - start_time).count();
+
+    std::cout << std::left << std::setw(22) << C4_BENCH_VARIANT
+              << std::setw(16) << suite.stem().string()
+              << std::right << std::setw(10) << positions.size()
+              << std::setw(20) << solver.get_merged_stats().get_num_nodes()
+              << std::setw(12) << std::fixed << std::setprecision(2) << seconds << std::endl;
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::cout.imbue(std::locale(""));
+
+    int max_positions = (argc > 1) ? std::stoi(argv[1]) : DEFAULT_POSITIONS_PER_SUITE;
+    std::vector<std::filesystem::path> suites = find_suites();
+    if (suites.empty()) {
+        std::cerr << "No test suites found for a " << BOARD_WIDTH << "x" << BOARD_HEIGHT << " board." << std::endl;
+        return 1;
+    }
+
+    Solver solver{};
+    std::cout << solver.get_settings_string()
+              << "Replacement policy: " << DefaultReplacementPolicy::NAME << ", incremental threats "
+              << (ENABLE_INCREMENTAL_THREATS ? "on" : "off") << "." << std::endl
+              << std::endl
+              << std::left << std::setw(22) << "Variant" << std::setw(16) << "Suite"
+              << std::right << std::setw(10) << "Positions" << std::setw(20) << "Nodes"
+              << std::setw(12) << "Time (s)" << std::endl;
+
+    for (const std::filesystem::path &suite : suites) {
+        if (!run_suite(solver, suite, max_positions)) {
+            return 1;
+        }
+    }
+
+    std::cout << std::endl;
+    return 0;
+}
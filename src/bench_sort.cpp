@@ -0,0 +1,130 @@
+/*
+
+This program compares the sorting network used to order moves with std::sort. Move lists of
+every length up to the board width are sorted, with scores drawn the same way as the move
+ordering heuristic: a few threats, a table move bonus, a center bonus and some jitter. Build
+and run it with:
+
+    cmake --build . --target bench_sort
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "solver/settings.h"
+#include "solver/util/sorting_network.h"
+
+static inline constexpr int NUM_LISTS = 1 << 12;
+static inline constexpr int NUM_REPEATS = 2000;
+
+struct MoveList {
+    int num_moves;
+    int moves[BOARD_WIDTH];
+    float scores[BOARD_WIDTH];
+};
+
+static std::vector<MoveList> generate_lists() {
+    std::mt19937 rand(0);
+    std::uniform_int_distribution<int> num_threats(0, 3);
+    std::uniform_int_distribution<int> jitter(0, 2);
+
+    std::vector<MoveList> lists(NUM_LISTS);
+    for (MoveList &list : lists) {
+        list.num_moves = 1 + rand() % BOARD_WIDTH;
+
+        // Moves are listed by column, with some columns already full or pruned.
+        std::vector<int> cols(BOARD_WIDTH);
+        for (int col = 0; col < BOARD_WIDTH; col++) {
+            cols[col] = col;
+        }
+        std::shuffle(cols.begin(), cols.end(), rand);
+        std::sort(cols.begin(), cols.begin() + list.num_moves);
+
+        for (int col = 0; col < BOARD_WIDTH; col++) {
+            float center_score = (float)std::min(col, BOARD_WIDTH - col - 1) / BOARD_WIDTH;
+
+            list.scores[col] = 1.2f * num_threats(rand) + 0.5f * num_threats(rand) + 0.3f * num_threats(rand)
+                + 0.1f * center_score + 0.3f * jitter(rand);
+        }
+
+        std::copy(cols.begin(), cols.begin() + list.num_moves, list.moves);
+    }
+
+    return lists;
+}
+
+// Returns the nanoseconds taken per list by the fastest of several runs.
+template <class Sort>
+static double time_sort(const std::vector<MoveList> &lists, Sort sort, long long &checksum) {
+    double best = 1e30;
+
+    for (int repeat = 0; repeat < NUM_REPEATS; repeat++) {
+        auto start_time = std::chrono::steady_clock::now();
+
+        for (const MoveList &list : lists) {
+            int moves[BOARD_WIDTH];
+            std::copy(list.moves, list.moves + list.num_moves, moves);
+
+            sort(moves, list.num_moves, list.scores);
+            checksum += moves[0];
+        }
+
+        auto end_time = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(end_time - start_time).count() / NUM_LISTS);
+    }
+
+    return best;
+}
+
+static void std_sort(int *moves, int num_moves, const float *scores) {
+    std::sort(moves, moves + num_moves, [scores](int a, int b) { return scores[a] > scores[b]; });
+}
+
+static void network_sort(int *moves, int num_moves, const float *scores) {
+    sort_columns_by_score<BOARD_WIDTH>(moves, num_moves, [scores](int col) { return scores[col]; });
+}
+
+int main() {
+    std::vector<MoveList> lists = generate_lists();
+
+    // Both sorts must produce the same order, including between equal scores. The weights can be
+    // changed at runtime, so the lists are also checked with negative scores.
+    for (float offset : {0.0f, -2.0f}) {
+        for (const MoveList &list : lists) {
+            float scores[BOARD_WIDTH];
+            for (int col = 0; col < BOARD_WIDTH; col++) {
+                scores[col] = list.scores[col] + offset;
+            }
+
+            int expected[BOARD_WIDTH], actual[BOARD_WIDTH];
+            std::copy(list.moves, list.moves + list.num_moves, expected);
+            std::copy(list.moves, list.moves + list.num_moves, actual);
+
+            std_sort(expected, list.num_moves, scores);
+            network_sort(actual, list.num_moves, scores);
+
+            if (!std::equal(expected, expected + list.num_moves, actual)) {
+                std::cerr << "Error: the sorting network and std::sort ordered a list differently." << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    long long checksum = 0;
+    double std_sort_ns = time_sort(lists, std_sort, checksum);
+    double network_ns = time_sort(lists, network_sort, checksum);
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Sorting " << NUM_LISTS << " move lists of up to " << BOARD_WIDTH << " moves, with a network of "
+              << SortingNetwork<BOARD_WIDTH>::num_comparators() << " comparators." << std::endl
+              << "std::sort:       " << std::setw(6) << std_sort_ns << " ns per list" << std::endl
+              << "Sorting network: " << std::setw(6) << network_ns << " ns per list" << std::endl
+              << "(checksum " << checksum << ")" << std::endl;
+
+    return 0;
+}
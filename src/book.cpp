@@ -148,6 +148,8 @@ int main() {
               << std::endl
               << root_solver.get_merged_stats().display_all_stats();
 
+    root_solver.save_table_snapshot();
+
     // Prevent console closing immediately after finishing on Windows.
     std::cout << "Press enter to exit." << std::endl;
     std::cin.get();
@@ -74,6 +74,8 @@ int main() {
               << std::endl
               << solver.get_merged_stats().display_all_stats() << std::endl;
 
+    solver.save_table_snapshot();
+
     // Prevent console closing immediately after finishing on Windows.
     std::cout << "Press enter to exit." << std::endl;
     std::cin.get();
@@ -7,6 +7,7 @@ outcome of the game if both players play perfectly.
 */
 
 #include <iostream>
+#include <optional>
 #include <string>
 
 #include "solver/position.h"
@@ -69,17 +70,13 @@ static int get_move(const Position &pos) {
     }
 }
 
-static void print_best_moves(Solver &solver, Position &pos, int score) {
+static void print_best_moves(Solver &solver, const Position &pos, int score) {
     // Draw a ^ under the optimal columns to play in.
     for (int i = 0; i < BOARD_WIDTH; i++) {
         bool is_optimal_move = false;
 
         if (pos.is_move_valid(i)) {
-            board before_move = pos.move(i);
-            int move_score = -solver.solve(pos, -score, -score + 1);
-            pos.unmove(before_move);
-
-            is_optimal_move = move_score >= score;
+            is_optimal_move = solver.is_best_move(pos, i, score);
         }
 
         std::cout << (is_optimal_move ? " ^" : "  ");
@@ -125,6 +122,9 @@ int main() {
 
     board before_moves[BOARD_WIDTH * BOARD_HEIGHT];
 
+    // After a move, the negated score of the last position is usually close to the new score.
+    std::optional<int> guess;
+
     std::cout << solver.get_settings_string()
               << "The optimal moves will be indicated by a \"^\" under the column." << std::endl
               << std::endl;
@@ -139,9 +139,11 @@ int main() {
         if (pos.is_game_over()) {
             print_result(pos);
         } else {
-            int score = solver.solve_strong(pos);
+            int score = solver.solve_strong(pos, guess);
             print_best_moves(solver, pos, score);
             print_score(pos, score);
+
+            guess = -score;
         }
 
         int move = get_move(pos);
@@ -149,8 +151,10 @@ int main() {
         // Move, unmove, or reset.
         if (move == BACK_MOVE_FLAG) {
             pos.unmove(before_moves[num_moves - 1]);
+            guess.reset();
         } else if (move == RESET_FLAG) {
             pos = Position();
+            guess.reset();
         } else {
             before_moves[num_moves] = pos.move(move);
         }
@@ -1,29 +1,37 @@
 #include "entry.h"
 
+#include <algorithm>
 #include <cassert>
 
-Entry::Entry(board hash, int move, NodeType type, int score, unsigned long long num_nodes) noexcept {
+Entry::Entry(board hash, int move, NodeType type, int score, unsigned long long num_nodes, int epoch) noexcept {
     assert(0 <= move && move < BOARD_WIDTH);
     assert(type == NodeType::EXACT || type == NodeType::LOWER || type == NodeType::UPPER);
     assert(Position::MIN_SCORE <= score && score <= Position::MAX_SCORE);
-
-    int int_type = static_cast<int>(type);
-
-    // Shift so we don't store negative numbers in the table.
-    int shifted_score = score - Position::MIN_SCORE;
+    assert(0 <= epoch && epoch < num_epochs());
 
     // Compress number of nodes into the space availiable.
     int work = num_nodes_to_work(num_nodes);
 
+    // Scores are shifted so we don't store negative numbers in the table.
+    Data bounds;
+    if constexpr (BOTH_BOUNDS) {
+        int lower = (type == NodeType::UPPER) ? Position::MIN_SCORE : score;
+        int upper = (type == NodeType::LOWER) ? Position::MAX_SCORE : score;
+
+        bounds = ((lower - Position::MIN_SCORE) << SCORE_SHIFT) | ((upper - Position::MIN_SCORE) << BOUND_SHIFT);
+    } else {
+        bounds = ((score - Position::MIN_SCORE) << SCORE_SHIFT) | (static_cast<int>(type) << BOUND_SHIFT);
+    }
+
     // Only the partial hash needs to be stored. This is equivalent to:
     // hash % 2^HASH_BITS.
     // clang-format off
     data
-        = static_cast<uint64_t>(hash << HASH_SHIFT)  
+        = static_cast<Data>(hash << HASH_SHIFT)  
+        | (epoch << EPOCH_SHIFT)
         | (move << MOVE_SHIFT)
-        | (int_type << TYPE_SHIFT)
         | (work << WORK_SHIFT)
-        | (shifted_score << SCORE_SHIFT);
+        | bounds;
     // clang-format on
 }
 
@@ -36,6 +44,10 @@ int Entry::get_move(bool is_mirrored) const noexcept {
 }
 
 int Entry::get_score() const noexcept {
+    if constexpr (BOTH_BOUNDS) {
+        return (get_type() == NodeType::UPPER) ? get_upper_bound() : get_lower_bound();
+    }
+
     int bits = (data >> SCORE_SHIFT) & SCORE_MASK;
 
     // We don't store negative numbers in the table, so scores
@@ -44,13 +56,90 @@ int Entry::get_score() const noexcept {
 }
 
 NodeType Entry::get_type() const noexcept {
-    int bits = (data >> TYPE_SHIFT) & TYPE_MASK;
+    if constexpr (BOTH_BOUNDS) {
+        if (is_empty()) {
+            return NodeType::MISS;
+        }
+
+        int lower = get_lower_bound();
+        if (lower == get_upper_bound()) {
+            return NodeType::EXACT;
+        }
+
+        return (lower == Position::MIN_SCORE) ? NodeType::UPPER : NodeType::LOWER;
+    }
+
+    int bits = (data >> BOUND_SHIFT) & BOUND_MASK;
 
     return static_cast<NodeType>(bits);
 }
 
+int Entry::get_lower_bound() const noexcept {
+    if constexpr (BOTH_BOUNDS) {
+        return ((data >> SCORE_SHIFT) & SCORE_MASK) + Position::MIN_SCORE;
+    }
+
+    NodeType type = get_type();
+    return (type == NodeType::LOWER || type == NodeType::EXACT) ? get_score() : Position::MIN_SCORE;
+}
+
+int Entry::get_upper_bound() const noexcept {
+    if constexpr (BOTH_BOUNDS) {
+        // An empty entry would otherwise report the minimum score as its upper bound.
+        if (is_empty()) {
+            return Position::MAX_SCORE;
+        }
+
+        return ((data >> BOUND_SHIFT) & BOUND_MASK) + Position::MIN_SCORE;
+    }
+
+    NodeType type = get_type();
+    return (type == NodeType::UPPER || type == NodeType::EXACT) ? get_score() : Position::MAX_SCORE;
+}
+
 int Entry::get_work() const noexcept { return (data >> WORK_SHIFT) & WORK_MASK; }
 
+int Entry::get_epoch() const noexcept { return (data >> EPOCH_SHIFT) & EPOCH_MASK; }
+
+Entry Entry::with_epoch(int epoch) const noexcept {
+    assert(0 <= epoch && epoch < num_epochs());
+
+    Entry result;
+    result.data = (data & ~(static_cast<Data>(EPOCH_MASK) << EPOCH_SHIFT)) | (static_cast<Data>(epoch) << EPOCH_SHIFT);
+
+    return result;
+}
+
+Entry Entry::merge(Entry older) const noexcept {
+    if constexpr (!BOTH_BOUNDS) {
+        return *this;
+    }
+
+    int lower = std::max(get_lower_bound(), older.get_lower_bound());
+    int upper = std::min(get_upper_bound(), older.get_upper_bound());
+
+    // Every stored bound holds for the true score, so the bounds should always overlap.
+    if (lower > upper) {
+        return *this;
+    }
+
+    // Keep the move which proved the best lower bound, since that is the move searched first.
+    int move = (get_lower_bound() >= older.get_lower_bound()) ? get_move(false) : older.get_move(false);
+    int work = std::max(get_work(), older.get_work());
+
+    Entry result;
+    // clang-format off
+    result.data
+        = (data & ~((static_cast<Data>(1) << EPOCH_SHIFT) - 1))
+        | (static_cast<Data>(move) << MOVE_SHIFT)
+        | (static_cast<Data>(work) << WORK_SHIFT)
+        | (static_cast<Data>(lower - Position::MIN_SCORE) << SCORE_SHIFT)
+        | (static_cast<Data>(upper - Position::MIN_SCORE) << BOUND_SHIFT);
+    // clang-format on
+
+    return result;
+}
+
 int Entry::num_nodes_to_work(unsigned long long num_nodes) const noexcept {
     int work = 0;
 
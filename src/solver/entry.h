@@ -1,71 +1,146 @@
 #ifndef ENTRY_H_
 #define ENTRY_H_
 
+#include <bit>
 #include <cstdint>
+#include <type_traits>
 
 #include "position.h"
 #include "settings.h"
 
-constexpr uint64_t const_log2(const uint64_t n) { return (n <= 1) ? 0 : 1 + const_log2(n / 2); }
-
 // Defines a single entry in the transposition table.
 class Entry {
    public:
     Entry() noexcept {};
-    Entry(board hash, int move, NodeType type, int score, unsigned long long num_nodes) noexcept;
+    Entry(board hash, int move, NodeType type, int score, unsigned long long num_nodes, int epoch = 0) noexcept;
 
     inline bool is_empty() const noexcept { return data == 0; }
     inline bool is_equal(board hash) const noexcept { return data != 0 && (hash & HASH_MASK) == (data >> HASH_SHIFT); }
 
     int get_move(bool is_mirrored) const noexcept;
+
+    // Entries which store both bounds report the bound which is known. An entry with two
+    // informative bounds reports LOWER, and the upper bound is only available below.
     int get_score() const noexcept;
     NodeType get_type() const noexcept;
+
+    // Returns the bounds on the true score of the position. Missing bounds are reported as
+    // the minimum or maximum possible score.
+    int get_lower_bound() const noexcept;
+    int get_upper_bound() const noexcept;
+
     int get_work() const noexcept;
+    int get_epoch() const noexcept;
+
+    // Returns the number of epochs since this entry was stored or last used. Epochs wrap
+    // around, so an entry which has not been used for num_epochs() epochs will look new again.
+    int get_age(int epoch) const noexcept { return (epoch - get_epoch()) & EPOCH_MASK; }
+
+    // Returns a copy of this entry marked as used in the given epoch.
+    Entry with_epoch(int epoch) const noexcept;
+
+    // Returns this entry combined with an older entry of the same position. If both bounds
+    // are stored then the tightest of each is kept, otherwise this entry replaces the old one.
+    Entry merge(Entry older) const noexcept;
+
+    // Not all bits of the hash are saved, however the hashing will still be unique by the Chinese
+    // Remainder Theorem as long as the number of buckets in the table is odd, and is at least
+    // this minimum.
+    static constexpr uint64_t min_num_buckets() noexcept {
+        constexpr int min_log2 = (BOARD_HEIGHT + 1) * BOARD_WIDTH - HASH_BITS + 2;
+
+        return (min_log2 > 0) ? (uint64_t)1 << min_log2 : 1;
+    }
+
+    static constexpr int num_epochs() noexcept { return 1 << EPOCH_BITS; }
+
+    static constexpr int max_work() noexcept { return WORK_MASK; }
+
+    static constexpr bool stores_both_bounds() noexcept { return BOTH_BOUNDS; }
+
+    static constexpr bool is_compact() noexcept { return IS_COMPACT; }
+
+    // Describes where each field is packed into an entry, so saved tables are only read
+    // back by builds which pack entries the same way.
+    static constexpr uint64_t get_layout() noexcept {
+        // clang-format off
+        return static_cast<uint64_t>(SCORE_SHIFT)
+            | static_cast<uint64_t>(BOUND_SHIFT) << 8
+            | static_cast<uint64_t>(MOVE_SHIFT) << 16
+            | static_cast<uint64_t>(WORK_SHIFT) << 24
+            | static_cast<uint64_t>(EPOCH_SHIFT) << 32
+            | static_cast<uint64_t>(HASH_SHIFT) << 40
+            | static_cast<uint64_t>(sizeof(data)) << 48;
+        // clang-format on
+    }
 
    private:
-    // An entry contains the following information packed in 64 bits.
+    // An entry contains the following information packed in 64 bits. The score and
+    // move fields are only as wide as the board needs, which is shown below for 7x6.
     //    bits: data
-    //  0 -  6: Score
-    //  7 -  8: Type
-    //  9 - 12: Move
-    // 13 - 17: Work
-    // 18 - 64: Parital hash
-    uint64_t data{0};
-
-    // The constants below define where information is packed into each 64 bit entry.
-    static constexpr int SCORE_BITS = 7;
+    //  0 -  5: Lower bound
+    //  6 - 11: Upper bound
+    // 12 - 14: Move
+    // 15 - 18: Work
+    // 19 - 21: Epoch
+    // 22 - 64: Parital hash
+    //
+    // On larger boards the hash bits given up for the upper bound would need a table of
+    // many gigabytes for the hash to stay unique, so instead a single score is stored
+    // in bits 0 - 5 along with a 2 bit type saying which bound it is. On small boards
+    // the whole entry is packed into 32 bits, so each bucket holds twice as many entries.
+
+    // The constants below define where information is packed into each entry.
+    static constexpr int SCORE_BITS = std::bit_width(static_cast<unsigned>(Position::MAX_SCORE - Position::MIN_SCORE));
     static constexpr int SCORE_MASK = (1 << SCORE_BITS) - 1;
     static constexpr int SCORE_SHIFT = 0;
 
     static constexpr int TYPE_BITS = 2;
-    static constexpr int TYPE_MASK = (1 << TYPE_BITS) - 1;
-    static constexpr int TYPE_SHIFT = SCORE_BITS;
 
-    static constexpr int MOVE_BITS = 4;
+    static constexpr int MOVE_BITS = std::bit_width(static_cast<unsigned>(BOARD_WIDTH - 1));
+
+    // Work is stored as log_8 of the number of nodes, so 4 bits covers searches of up to 8^15 nodes.
+    static constexpr int WORK_BITS = 4;
+
+    static constexpr int EPOCH_BITS = 3;
+
+    // A layout is only used if it leaves enough hash bits for the table to be unique
+    // with at most 2^20 buckets (64 MB). Compact entries are preferred, since doubling
+    // the number of entries is worth more than storing both bounds.
+    static constexpr int MIN_HASH_BITS = (BOARD_HEIGHT + 1) * BOARD_WIDTH + 2 - 20;
+    static constexpr int ONE_BOUND_BITS = SCORE_BITS + TYPE_BITS + MOVE_BITS + WORK_BITS + EPOCH_BITS;
+    static constexpr int TWO_BOUND_BITS = 2 * SCORE_BITS + MOVE_BITS + WORK_BITS + EPOCH_BITS;
+
+    static constexpr bool IS_COMPACT = 32 - ONE_BOUND_BITS >= MIN_HASH_BITS;
+    static constexpr bool BOTH_BOUNDS = (IS_COMPACT ? 32 : 64) - TWO_BOUND_BITS >= MIN_HASH_BITS;
+
+    using Data = std::conditional_t<IS_COMPACT, uint32_t, uint64_t>;
+    Data data{0};
+
+    // Holds the upper bound if both bounds are stored, otherwise the type of the score.
+    static constexpr int BOUND_BITS = BOTH_BOUNDS ? SCORE_BITS : TYPE_BITS;
+    static constexpr int BOUND_MASK = (1 << BOUND_BITS) - 1;
+    static constexpr int BOUND_SHIFT = SCORE_SHIFT + SCORE_BITS;
+
     static constexpr int MOVE_MASK = (1 << MOVE_BITS) - 1;
-    static constexpr int MOVE_SHIFT = TYPE_SHIFT + TYPE_BITS;
+    static constexpr int MOVE_SHIFT = BOUND_SHIFT + BOUND_BITS;
 
-    static constexpr int WORK_BITS = 5;
     static constexpr int WORK_MASK = (1 << WORK_BITS) - 1;
     static constexpr int WORK_SHIFT = MOVE_SHIFT + MOVE_BITS;
 
-    static constexpr int HASH_BITS = 8 * sizeof(data) - WORK_SHIFT - WORK_BITS;
-    static constexpr uint64_t HASH_MASK = ((uint64_t)1 << HASH_BITS) - 1;
-    static constexpr int HASH_SHIFT = WORK_SHIFT + WORK_BITS;
+    static constexpr int EPOCH_MASK = (1 << EPOCH_BITS) - 1;
+    static constexpr int EPOCH_SHIFT = WORK_SHIFT + WORK_BITS;
 
-    // Not all bits of the hash are saved, however the hashing will still be unique
-    // by the Chinese Remainder Theorem as long as the check below passes.
-    static_assert(const_log2(NUM_TABLE_ENTRIES) + HASH_BITS - 1 > (BOARD_HEIGHT + 1) * BOARD_WIDTH);
-
-    // The number of entries must be odd otherwise CRT does not apply.
-    static_assert(NUM_TABLE_ENTRIES % 2 == 1);
+    static constexpr int HASH_BITS = 8 * sizeof(Data) - EPOCH_SHIFT - EPOCH_BITS;
+    static constexpr Data HASH_MASK = (static_cast<Data>(1) << HASH_BITS) - 1;
+    static constexpr int HASH_SHIFT = EPOCH_SHIFT + EPOCH_BITS;
 
     // Move bits must be wide enough to store any valid move.
     static_assert((1 << MOVE_BITS) >= BOARD_WIDTH);
 
     // Score bits must be wide enough to store the entire range of possible scores.
     static_assert((1 << SCORE_BITS) > Position::MAX_SCORE - Position::MIN_SCORE);
-    
+
     int num_nodes_to_work(unsigned long long num_nodes) const noexcept;
 };
 
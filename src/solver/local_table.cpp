@@ -0,0 +1,84 @@
+#include "local_table.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+#include "position.h"
+#include "settings.h"
+
+LocalTable::LocalTable(std::shared_ptr<Stats> stats) : stats(std::move(stats)) {
+    uint64_t num_pairs = std::bit_floor(std::max<uint64_t>(LOCAL_TABLE_SIZE / sizeof(LocalEntry) / ENTRIES_PER_PAIR, 1));
+
+    this->table = std::make_unique<LocalEntry[]>(num_pairs * ENTRIES_PER_PAIR);
+    this->pair_mask = num_pairs - 1;
+    this->pair_shift = 64 - std::countr_zero(num_pairs);
+}
+
+void LocalTable::clear() {
+    std::fill(table.get(), table.get() + (pair_mask + 1) * ENTRIES_PER_PAIR, LocalEntry{});
+}
+
+Entry LocalTable::get(board hash) const noexcept {
+    assert(hash != 0);
+
+    const LocalEntry *pair = get_pair(hash);
+    for (int i = 0; i < ENTRIES_PER_PAIR; i++) {
+        if (pair[i].hash == hash) {
+            stats->local_lookup_success();
+            return pair[i].entry;
+        }
+    }
+
+    stats->local_lookup_miss();
+    return Entry();
+}
+
+void LocalTable::put(board hash, bool is_mirrored, int move, NodeType type, int score,
+                     unsigned long long num_nodes) noexcept {
+    assert(hash != 0);
+    assert(0 <= move && move < BOARD_WIDTH);
+    assert(Position::MIN_SCORE <= score && score <= Position::MAX_SCORE);
+
+    // Move needs to be mirrored as well if we are storing the mirrored position.
+    if (is_mirrored) {
+        move = BOARD_WIDTH - move - 1;
+    }
+
+    // Rewrite the position if it is already stored, otherwise replace the entry with the least work.
+    LocalEntry *pair = get_pair(hash);
+    LocalEntry *slot = (pair[1].entry.get_work() < pair[0].entry.get_work()) ? &pair[1] : &pair[0];
+    for (int i = 0; i < ENTRIES_PER_PAIR; i++) {
+        if (pair[i].hash == hash) {
+            slot = &pair[i];
+        }
+    }
+
+    Entry entry(hash, move, type, score, num_nodes);
+    if (slot->hash == hash) {
+        // If the position is already stored as an exact entry, then there is no more information we could add.
+        if (slot->entry.get_type() == NodeType::EXACT) {
+            return;
+        }
+
+        entry = entry.merge(slot->entry);
+    }
+
+    slot->hash = hash;
+    slot->entry = entry;
+}
+
+LocalTable::LocalEntry *LocalTable::get_pair(board hash) const noexcept {
+    // Positions which differ only in a few stones have similar hashes, so mix all bits of the
+    // hash into the index with a multiplicative hash.
+    uint64_t folded;
+    if constexpr (IS_128_BIT_BOARD) {
+        folded = static_cast<uint64_t>(hash) ^ static_cast<uint64_t>(hash >> 64);
+    } else {
+        folded = static_cast<uint64_t>(hash);
+    }
+
+    uint64_t index = (pair_shift < 64) ? (folded * 0x9E3779B97F4A7C15ull) >> pair_shift : 0;
+
+    return &table[(index & pair_mask) * ENTRIES_PER_PAIR];
+}
@@ -0,0 +1,44 @@
+#ifndef LOCAL_TABLE_H_
+#define LOCAL_TABLE_H_
+
+#include <memory>
+
+#include "entry.h"
+#include "types.h"
+#include "util/stats.h"
+
+// A small transposition table private to a single search thread. Positions near the leaves
+// are cheap to search and are rarely seen by other threads, so keeping them in a table small
+// enough to stay in the core's cache avoids going to main memory, and avoids moving cache lines
+// between cores.
+//
+// Unlike the shared table, the full hash is stored with each entry, so any size is valid.
+// Not thread safe.
+class LocalTable {
+   public:
+    explicit LocalTable(std::shared_ptr<Stats> stats);
+
+    void clear();
+
+    Entry get(board hash) const noexcept;
+    void put(board hash, bool is_mirrored, int move, NodeType type, int score, unsigned long long num_nodes) noexcept;
+
+   private:
+    struct LocalEntry {
+        board hash;
+        Entry entry;
+    };
+
+    // Entries are grouped into pairs, and the entry with the least work in a pair is replaced.
+    static constexpr int ENTRIES_PER_PAIR = 2;
+
+    std::unique_ptr<LocalEntry[]> table;
+    uint64_t pair_mask;
+    int pair_shift;
+
+    std::shared_ptr<Stats> stats;
+
+    LocalEntry *get_pair(board hash) const noexcept;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "marks.h"
+
+#include <bit>
+#include <cassert>
+
+SearchMarks::SearchMarks() {
+    this->marks = std::make_unique<std::atomic<uint16_t>[]>(NUM_MARKS);
+}
+
+void SearchMarks::mark(board hash) noexcept {
+    get_mark(hash).fetch_add(1, std::memory_order_relaxed);
+}
+
+void SearchMarks::unmark(board hash) noexcept {
+    [[maybe_unused]] uint16_t count = get_mark(hash).fetch_sub(1, std::memory_order_relaxed);
+    assert(count > 0);
+}
+
+bool SearchMarks::is_marked(board hash) const noexcept {
+    return get_mark(hash).load(std::memory_order_relaxed) > 0;
+}
+
+std::atomic<uint16_t> &SearchMarks::get_mark(board hash) const noexcept {
+    // Mix all bits of the hash into the index, as in the local table.
+    uint64_t folded;
+    if constexpr (IS_128_BIT_BOARD) {
+        folded = static_cast<uint64_t>(hash) ^ static_cast<uint64_t>(hash >> 64);
+    } else {
+        folded = static_cast<uint64_t>(hash);
+    }
+
+    uint64_t index = (folded * 0x9E3779B97F4A7C15ull) >> (64 - std::countr_zero<unsigned>(NUM_MARKS));
+
+    return marks[index];
+}
@@ -0,0 +1,32 @@
+#ifndef MARKS_H_
+#define MARKS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "types.h"
+
+// Marks the positions which search threads are searching right now, shared by all threads. Used
+// by ABDADA to steer threads away from subtrees another thread is already searching.
+//
+// Marks are counters in a small array indexed by the hash, without storing the hash itself, so
+// a position can look marked because of another position with the same index. This only changes
+// the order moves are searched in. Thread safe.
+class SearchMarks {
+   public:
+    SearchMarks();
+
+    void mark(board hash) noexcept;
+    void unmark(board hash) noexcept;
+    bool is_marked(board hash) const noexcept;
+
+   private:
+    static constexpr int NUM_MARKS = 1 << 16;
+
+    std::unique_ptr<std::atomic<uint16_t>[]> marks;
+
+    std::atomic<uint16_t> &get_mark(board hash) const noexcept;
+};
+
+#endif
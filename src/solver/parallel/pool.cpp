@@ -4,16 +4,19 @@
 #include <cassert>
 #include <iostream>
 #include <iomanip>
+#include <optional>
 #include <vector>
 
 #include "../settings.h"
 #include "../table.h"
+#include "../util/os.h"
 
 // Search returning this value means the search was cancelled.
 inline constexpr int SEARCH_CANCELLED = 1001;
 
 int Pool::get_score_jitter(double window_step, size_t i) {
-    if (get_num_workers() == 1) {
+    // ABDADA spreads the workers across the tree without jitter.
+    if (get_num_workers() == 1 || ENABLE_ABDADA) {
         return 0;
     }
 
@@ -42,9 +45,20 @@ Pool::Pool(const Table &parent_table, std::shared_ptr<Progress> progress) {
         ? std::thread::hardware_concurrency()
         : NUM_THREADS;
 
+    // Place workers following the CPU topology, so threads do not migrate between cores and lose their caches.
+    std::vector<int> cpus;
+    if (ENABLE_AFFINITY) {
+        cpus = get_cpu_placement(AFFINITY_SPREAD_SOCKETS);
+    }
+
+    // All workers share the marks, so they can see which positions the others are searching.
+    std::shared_ptr<SearchMarks> marks = std::make_shared<SearchMarks>();
+
     this->result = std::make_shared<SearchResult>();
     for (int i = 0; i < num_workers; i++) {
-        workers.push_back(std::make_unique<Worker>(i, parent_table, result, progress));
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+
+        workers.push_back(std::make_unique<Worker>(i, cpu, parent_table, marks, result, progress));
     }
 
     this->progress = std::move(progress);
@@ -74,13 +88,14 @@ int Pool::search(const Position &pos, int alpha, int beta) {
 
     // Start the clock.
     std::chrono::steady_clock::time_point search_start_time = std::chrono::steady_clock::now();
+    PageFaults start_faults = get_page_faults();
     progress->started_search(alpha, beta, search_start_time);
 
     // Pass the new position to the workers and start searching.
     for (size_t i = 0; i < workers.size(); i++) {
         int score_jitter = get_score_jitter((double) (beta - alpha) / workers.size(), i);
 
-        workers[i]->start(pos, alpha, beta, score_jitter);
+        workers[i]->start(pos, alpha, beta, score_jitter, false);
     }
 
     // Block until any of the workers find the solution.
@@ -91,8 +106,11 @@ int Pool::search(const Position &pos, int alpha, int beta) {
     wait_all();
 
     // Update stats by merging together all worker stats.
+    PageFaults end_faults = get_page_faults();
+
     Stats search_stats;
     search_stats.completed_search(search_start_time);
+    search_stats.page_faults(end_faults.minor - start_faults.minor, end_faults.major - start_faults.major);
     merge_stats(search_stats);
 
     progress->completed_search(score, search_stats);
@@ -100,6 +118,161 @@ int Pool::search(const Position &pos, int alpha, int beta) {
     return score;
 }
 
+int Pool::probe_windows(const Position &pos, int alpha, int beta, int guess) {
+    assert(alpha < beta);
+
+    assert(pos.score_loss() <= alpha);
+    assert(Position::MIN_SCORE <= alpha);
+    assert(beta <= pos.score_win());
+    assert(beta <= Position::MAX_SCORE);
+
+    assert(!pos.is_game_over());
+    assert(!pos.wins_this_move(pos.find_player_threats()));
+
+    // Do not allow more than one search to run.
+    std::unique_lock<std::mutex> lock(mutex);
+
+    result->reset();
+
+    // Start the clock.
+    std::chrono::steady_clock::time_point search_start_time = std::chrono::steady_clock::now();
+    PageFaults start_faults = get_page_faults();
+    progress->started_search(alpha, beta, search_start_time);
+
+    // The window each group of workers was last started on. The stats of a group's workers
+    // are merged when the group is stopped, as starting a worker resets its stats.
+    int num_groups = get_num_probes();
+    std::vector<std::optional<int>> group_windows(num_groups);
+
+    Stats search_stats;
+    int score = guess;
+
+    while (alpha < beta) {
+        std::vector<int> windows = get_probe_windows(alpha, beta, score, num_groups);
+
+        // Stop the groups searching windows which are already known, such as a finished window.
+        for (int group = 0; group < num_groups; group++) {
+            if (group_windows[group].has_value()
+                    && std::find(windows.begin(), windows.end(), *group_windows[group]) == windows.end()) {
+                stop_group(group, num_groups, search_stats);
+                group_windows[group].reset();
+            }
+        }
+
+        // Move idle groups to the windows which no group is searching yet.
+        for (int window : windows) {
+            if (std::find(group_windows.begin(), group_windows.end(), window) != group_windows.end()) {
+                continue;
+            }
+
+            auto idle = std::find(group_windows.begin(), group_windows.end(), std::nullopt);
+            assert(idle != group_windows.end());
+
+            int group = static_cast<int>(idle - group_windows.begin());
+            start_group(group, num_groups, pos, window);
+            *idle = window;
+        }
+
+        // Results of windows which were stopped or already known are still valid bounds.
+        int window;
+        score = result->wait_for_probe(window);
+        if (score == SEARCH_CANCELLED) {
+            break;
+        }
+
+        if (score < window) {
+            beta = std::min(beta, score);
+        } else {
+            alpha = std::max(alpha, score);
+        }
+    }
+
+    // No need for the other workers to do anything else.
+    for (int group = 0; group < num_groups; group++) {
+        if (group_windows[group].has_value()) {
+            stop_group(group, num_groups, search_stats);
+        }
+    }
+
+    // The stats of every worker were merged as its group was stopped.
+    PageFaults end_faults = get_page_faults();
+
+    search_stats.completed_search(search_start_time);
+    search_stats.page_faults(end_faults.minor - start_faults.minor, end_faults.major - start_faults.major);
+    merged_stats.merge(search_stats);
+
+    progress->completed_search(score, search_stats);
+
+    return score;
+}
+
+std::vector<int> Pool::get_probe_windows(int alpha, int beta, int guess, int num_probes) {
+    assert(alpha < beta);
+
+    // A single search would try this window next. The others are the windows closest to
+    // it, which the single search would try next if the guess was close.
+    int first = std::clamp(guess, alpha + 1, beta);
+
+    std::vector<int> windows{first};
+    for (int step = 1; static_cast<int>(windows.size()) < num_probes; step++) {
+        bool is_above = first + step <= beta;
+        bool is_below = first - step > alpha;
+        if (!is_above && !is_below) {
+            break;
+        }
+
+        if (is_above) {
+            windows.push_back(first + step);
+        }
+        if (is_below && static_cast<int>(windows.size()) < num_probes) {
+            windows.push_back(first - step);
+        }
+    }
+
+    return windows;
+}
+
+void Pool::start_group(int group, int num_groups, const Position &pos, int window) {
+    size_t group_size = (workers.size() - group + num_groups - 1) / num_groups;
+
+    for (size_t i = group, j = 0; i < workers.size(); i += num_groups, j++) {
+        int score_jitter = get_score_jitter(1.0 / group_size, j);
+
+        workers[i]->start(pos, window - 1, window, score_jitter, true);
+    }
+}
+
+void Pool::stop_group(int group, int num_groups, Stats &search_stats) {
+    for (size_t i = group; i < workers.size(); i += num_groups) {
+        workers[i]->stop();
+    }
+
+    for (size_t i = group; i < workers.size(); i += num_groups) {
+        workers[i]->wait();
+        search_stats.merge(*workers[i]->get_stats());
+    }
+}
+
+void Pool::clear_table() {
+    // Do not clear the table while a search is running.
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (const std::unique_ptr<Worker> &worker : workers) {
+        worker->start_clear(static_cast<int>(workers.size()));
+    }
+
+    wait_all();
+}
+
+void Pool::set_weights(const HeuristicWeights &weights) {
+    // Do not change the weights while a search is running.
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (const std::unique_ptr<Worker> &worker : workers) {
+        worker->set_weights(weights);
+    }
+}
+
 void Pool::cancel() {
     result->notify_result(SEARCH_CANCELLED);
 }
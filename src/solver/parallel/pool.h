@@ -1,12 +1,14 @@
 #ifndef POOL_H_
 #define POOL_H_
 
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
 #include "../position.h"
+#include "../settings.h"
 #include "../table.h"
 #include "../util/progress.h"
 #include "result.h"
@@ -20,10 +22,20 @@ class Pool {
     int search(const Position &pos, int alpha, int beta);
     void cancel();
 
+    // Finds the score of the position within [alpha, beta] by probing several null windows
+    // next to the guess at the same time, with one group of workers on each window.
+    int probe_windows(const Position &pos, int alpha, int beta, int guess);
+
+    // Clear the table, splitting the work across all workers.
+    void clear_table();
+
+    void set_weights(const HeuristicWeights &weights);
+
     const Stats &get_merged_stats() const { return merged_stats; };
     void reset_stats() { merged_stats.reset(); }
 
     int get_num_workers() { return workers.size(); }
+    int get_num_probes() { return std::min(NUM_WINDOW_PROBES, get_num_workers()); }
 
    private:
     std::vector<std::unique_ptr<Worker>> workers;
@@ -39,6 +51,14 @@ class Pool {
     Stats merged_stats;
     int get_score_jitter(double window_step, size_t i);
 
+    // Returns the null windows inside (alpha, beta] which are most likely to be searched next,
+    // starting with the window a single search would use.
+    static std::vector<int> get_probe_windows(int alpha, int beta, int guess, int num_probes);
+
+    // Worker i is in group i % num_groups.
+    void start_group(int group, int num_groups, const Position &pos, int window);
+    void stop_group(int group, int num_groups, Stats &search_stats);
+
     void stop_all();
     void wait_all();
     void merge_stats(Stats &search_stats);
@@ -9,6 +9,7 @@ void SearchResult::reset() {
 
     score = SEARCH_STOPPED;
     found = false;
+    probes.clear();
 }
 
 bool SearchResult::notify_result(int result) {
@@ -38,3 +39,31 @@ int SearchResult::wait_for_result() {
     assert(score != SEARCH_STOPPED);
     return score;
 }
+
+void SearchResult::notify_probe(int window, int result) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    probes.emplace_back(window, result);
+
+    lock.unlock();
+    cond.notify_all();
+}
+
+int SearchResult::wait_for_probe(int &window) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!found && probes.empty()) {
+        cond.wait(lock);
+    }
+
+    // Only a cancelled search sets a result while probing.
+    if (found) {
+        return score;
+    }
+
+    auto [probe_window, probe_score] = probes.front();
+    probes.pop_front();
+
+    window = probe_window;
+    return probe_score;
+}
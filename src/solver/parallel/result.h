@@ -2,7 +2,9 @@
 #define RESULT_H_
 
 #include <condition_variable>
+#include <deque>
 #include <mutex>
+#include <utility>
 
 #include "../search.h"
 
@@ -13,10 +15,19 @@ class SearchResult {
     bool notify_result(int result);
     int wait_for_result();
 
+    // When probing several windows at once, every finished search is queued with the null window
+    // it searched, and the results are taken in the order they finished. Returns the result
+    // of the cancelled search if the search was cancelled.
+    void notify_probe(int window, int result);
+    int wait_for_probe(int &window);
+
    private:
     int score{SEARCH_STOPPED};
     bool found{false};
 
+    // Pairs of windows and scores.
+    std::deque<std::pair<int, int>> probes;
+
     std::mutex mutex;
     std::condition_variable cond;
 };
@@ -13,22 +13,25 @@
 #include "../position.h"
 #include "../util/os.h"
 
-Worker::Worker(int id, const Table &parent_table, std::shared_ptr<SearchResult> result,
-               std::shared_ptr<Progress> progress) {
+Worker::Worker(int id, int cpu, const Table &parent_table, std::shared_ptr<SearchMarks> marks,
+               std::shared_ptr<SearchResult> result, std::shared_ptr<Progress> progress)
+    : table(parent_table, std::make_shared<Stats>()) {
     this->id = id;
     this->result = std::move(result);
     this->stats = std::make_shared<Stats>();
-    this->search = std::make_unique<Search>(id, parent_table, stats, std::move(progress));
+    this->search = std::make_unique<Search>(id, parent_table, std::move(marks), stats, std::move(progress));
 
     // Start the thread, which will go to sleep until a position is submitted.
     this->thread = std::thread(&Worker::work, this);
-    set_thread_affinity(thread, id);
+    if (cpu != -1) {
+        set_thread_affinity(thread, cpu);
+    }
 }
 
 Worker::~Worker() {
     std::unique_lock<std::mutex> lock(mutex);
 
-    assert(!is_searching);
+    assert(job == Job::NONE);
     assert(!is_exiting);
 
     is_exiting = true;
@@ -41,7 +44,7 @@ Worker::~Worker() {
     }
 }
 
-void Worker::start(const Position &new_pos, int new_alpha, int new_beta, int new_score_jitter) {
+void Worker::start(const Position &new_pos, int new_alpha, int new_beta, int new_score_jitter, bool new_is_probe) {
     assert(new_alpha < new_beta);
     assert(new_score_jitter >= 0);
     
@@ -49,7 +52,7 @@ void Worker::start(const Position &new_pos, int new_alpha, int new_beta, int new
 
     // We should never try to start a search while another search is already
     // running.
-    assert(!is_searching);
+    assert(job == Job::NONE);
     assert(!is_exiting);
 
     // We are starting a new search, so reset all stats.
@@ -60,21 +63,45 @@ void Worker::start(const Position &new_pos, int new_alpha, int new_beta, int new
     alpha = new_alpha;
     beta = new_beta;
     score_jitter = new_score_jitter;
+    is_probe = new_is_probe;
 
     // Tells the thread to start searching the given position as soon
     // as we wake it up.
-    is_searching = true;
+    job = Job::SEARCH;
     search->start();
 
     cond.notify_one();
 }
 
+void Worker::start_clear(int new_num_parts) {
+    assert(0 <= id && id < new_num_parts);
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    assert(job == Job::NONE);
+    assert(!is_exiting);
+
+    num_parts = new_num_parts;
+    job = Job::CLEAR_TABLE;
+
+    cond.notify_one();
+}
+
+void Worker::set_weights(const HeuristicWeights &weights) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    assert(job == Job::NONE);
+    assert(!is_exiting);
+
+    search->set_weights(weights);
+}
+
 void Worker::wait() {
     std::unique_lock<std::mutex> lock(mutex);
 
-    // Block until the thread is done searching and
+    // Block until the thread is done with its job and
     // went back to sleep.
-    while (is_searching) {
+    while (job != Job::NONE) {
         cond.wait(lock);
     }
 }
@@ -88,21 +115,33 @@ void Worker::work() {
 
     while (!is_exiting) {
         // Sleep until we have something to do.
-        while (!is_searching && !is_exiting) {
+        while (job == Job::NONE && !is_exiting) {
             cond.wait(lock);
         }
 
         // We have a new position to search.
-        if (is_searching) {
+        if (job == Job::SEARCH) {
             int score = search->search(pos, alpha, beta, score_jitter);
-            is_searching = false;
+            job = Job::NONE;
 
             // Tell the main thread we've solved the position.
             if (abs(score) != SEARCH_STOPPED) {
-                result->notify_result(score);
+                if (is_probe) {
+                    result->notify_probe(beta, score);
+                } else {
+                    result->notify_result(score);
+                }
             }
         }
 
+        // We need to clear our part of the table.
+        if (job == Job::CLEAR_TABLE) {
+            table.clear(id, num_parts);
+            search->clear_local_table();
+            search->clear_move_history();
+            job = Job::NONE;
+        }
+
         cond.notify_one();
     }
 }
@@ -14,14 +14,25 @@
 
 class Worker {
    public:
-    Worker(int id, const Table &parent_table, std::shared_ptr<SearchResult> result,
-        std::shared_ptr<Progress> progress);
+    // The worker's thread is restricted to the given CPU, unless the CPU is -1.
+    Worker(int id, int cpu, const Table &parent_table, std::shared_ptr<SearchMarks> marks,
+        std::shared_ptr<SearchResult> result, std::shared_ptr<Progress> progress);
     ~Worker();
 
-    void start(const Position &new_pos, int new_alpha, int new_beta, int new_move_offset);
+    // Probes report their result along with their window, instead of ending the search.
+    void start(const Position &new_pos, int new_alpha, int new_beta, int new_move_offset, bool new_is_probe);
+
+    // Clear this worker's part of the table. Each worker clears a different part, so that
+    // pages are first touched by the threads which will use them. The worker's local table
+    // is also cleared.
+    void start_clear(int new_num_parts);
+
     void wait();
     void stop();
 
+    // Change the weights used to order moves. Must not be called during a search.
+    void set_weights(const HeuristicWeights &weights);
+
     const Stats *get_stats() const { return stats.get(); }
 
    private:
@@ -39,18 +50,29 @@ class Worker {
     // The object which is responsible for the single threaded search of a position.
     std::unique_ptr<Search> search;
 
+    // A handle to the table shared by all workers.
+    Table table;
+
+    enum class Job {
+        NONE,
+        SEARCH,
+        CLEAR_TABLE,
+    };
+
     // These locks guard the shared search data. Both the main thread and the worker
     // thread use the following data.
     std::mutex mutex;
     std::condition_variable cond;
 
-    bool is_searching{false};
+    Job job{Job::NONE};
     bool is_exiting{false};
 
     Position pos;
     int alpha;
     int beta;
     int score_jitter;
+    bool is_probe;
+    int num_parts;
     // End shared search data.
 
     void work();
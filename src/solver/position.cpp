@@ -1,12 +1,21 @@
 #include "position.h"
 
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 
 #include "settings.h"
 
+#if defined(__AVX2__) && defined(__SIZEOF_INT128__)
+#include <immintrin.h>
+#define C4_HAS_AVX2_KERNEL
+#endif
+
 // Represents a single direction in which a player can win.
 enum class Direction {
     VERTICAL = 1,
@@ -101,13 +110,195 @@ static board find_threats_in_direction(const board b) noexcept {
     }
 }
 
+#ifdef C4_HAS_AVX2_KERNEL
+
+// The AVX2 kernel below checks all four directions at once on 128 bit boards. Each 256 bit
+// register holds one 64 bit half of the board four times over, with one lane per direction,
+// in the order vertical, horizontal, negative diagonal, positive diagonal.
+struct BoardLanes {
+    __m256i low;
+    __m256i high;
+};
+
+static constexpr bool USE_AVX2_KERNEL = ENABLE_AVX2_KERNEL && IS_128_BIT_BOARD;
+
+// Each lane is shifted by at most three steps in its direction, so no lane shifts a full half.
+static_assert(!USE_AVX2_KERNEL || 3 * static_cast<int>(Direction::POSITIVE_DIAGONAL) < 64,
+    "The AVX2 kernel requires shifts smaller than 64 bits.");
+
+static inline BoardLanes broadcast_lanes(const __uint128_t b) noexcept {
+    return {_mm256_set1_epi64x(static_cast<long long>(b)), _mm256_set1_epi64x(static_cast<long long>(b >> 64))};
+}
+
+static inline BoardLanes operator&(const BoardLanes a, const BoardLanes b) noexcept {
+    return {_mm256_and_si256(a.low, b.low), _mm256_and_si256(a.high, b.high)};
+}
+
+static inline BoardLanes operator|(const BoardLanes a, const BoardLanes b) noexcept {
+    return {_mm256_or_si256(a.low, b.low), _mm256_or_si256(a.high, b.high)};
+}
+
+// Returns the shift of n steps in each lane's direction.
+template <int n>
+static inline __m256i lane_shifts() noexcept {
+    return _mm256_setr_epi64x(n * static_cast<int>(Direction::VERTICAL),
+        n * static_cast<int>(Direction::HORIZONTAL),
+        n * static_cast<int>(Direction::NEGATIVE_DIAGONAL),
+        n * static_cast<int>(Direction::POSITIVE_DIAGONAL));
+}
+
+// Shifts each lane n steps in its direction, carrying bits between the two halves of the board.
+template <int n>
+static inline BoardLanes shift_lanes_left(const BoardLanes b) noexcept {
+    __m256i shift = lane_shifts<n>();
+    __m256i carry_shift = _mm256_sub_epi64(_mm256_set1_epi64x(64), shift);
+
+    return {_mm256_sllv_epi64(b.low, shift),
+        _mm256_or_si256(_mm256_sllv_epi64(b.high, shift), _mm256_srlv_epi64(b.low, carry_shift))};
+}
+
+template <int n>
+static inline BoardLanes shift_lanes_right(const BoardLanes b) noexcept {
+    __m256i shift = lane_shifts<n>();
+    __m256i carry_shift = _mm256_sub_epi64(_mm256_set1_epi64x(64), shift);
+
+    return {_mm256_or_si256(_mm256_srlv_epi64(b.low, shift), _mm256_sllv_epi64(b.high, carry_shift)),
+        _mm256_srlv_epi64(b.high, shift)};
+}
+
+// Returns the union of the four lanes.
+static inline __uint128_t merge_lanes(const BoardLanes b) noexcept {
+    // Interleave the halves to get (low 0 | low 1, high 0 | high 1, low 2 | low 3, high 2 | high 3).
+    __m256i pairs = _mm256_or_si256(_mm256_unpacklo_epi64(b.low, b.high), _mm256_unpackhi_epi64(b.low, b.high));
+    __m128i merged = _mm_or_si128(_mm256_castsi256_si128(pairs), _mm256_extracti128_si256(pairs, 1));
+
+    __uint128_t low = static_cast<uint64_t>(_mm_cvtsi128_si64(merged));
+    __uint128_t high = static_cast<uint64_t>(_mm_extract_epi64(merged, 1));
+
+    return low | (high << 64);
+}
+
+// Same as find_threats_in_direction, in all directions at once.
+static inline board find_threats_avx2(const board b) noexcept {
+    BoardLanes lanes = broadcast_lanes(b);
+
+    BoardLanes doubles = lanes & shift_lanes_left<1>(lanes);
+    BoardLanes triples = doubles & shift_lanes_left<1>(doubles);
+
+    BoardLanes gaps = (shift_lanes_right<1>(lanes) & shift_lanes_left<1>(doubles))
+        | (shift_lanes_left<1>(lanes) & shift_lanes_right<2>(doubles))
+        | shift_lanes_right<3>(triples);
+
+    // Stones cannot be played below an empty cell, so the vertical lane only has threats above triples.
+    __m256i not_vertical = _mm256_setr_epi64x(0, -1, -1, -1);
+    gaps = {_mm256_and_si256(gaps.low, not_vertical), _mm256_and_si256(gaps.high, not_vertical)};
+
+    return static_cast<board>(merge_lanes(gaps | shift_lanes_left<1>(triples)));
+}
+
+// Same as has_won_in_direction, in all directions at once.
+static inline bool has_won_avx2(const board b) noexcept {
+    BoardLanes lanes = broadcast_lanes(b);
+
+    BoardLanes pairs = lanes & shift_lanes_left<2>(lanes);
+    BoardLanes quads = pairs & shift_lanes_left<1>(pairs);
+
+    __m256i any = _mm256_or_si256(quads.low, quads.high);
+
+    return !_mm256_testz_si256(any, any);
+}
+
+#endif
+
 static board find_threats(const board b) noexcept {
+#ifdef C4_HAS_AVX2_KERNEL
+    if constexpr (USE_AVX2_KERNEL) {
+        return find_threats_avx2(b);
+    }
+#endif
+
     return find_threats_in_direction<Direction::VERTICAL>(b)
          | find_threats_in_direction<Direction::HORIZONTAL>(b)
          | find_threats_in_direction<Direction::NEGATIVE_DIAGONAL>(b)
          | find_threats_in_direction<Direction::POSITIVE_DIAGONAL>(b);
 }
 
+#if C4_INCREMENTAL_THREATS
+
+// The cells in each direction through a single cell which can be in a four in a row with it.
+struct LineMasks {
+    board horizontal;
+    board negative_diagonal;
+    board positive_diagonal;
+};
+
+static constexpr board line_through_cell(int cell, Direction dir) {
+    int shift = static_cast<int>(dir);
+    board line = 0;
+
+    for (int i = -3; i <= 3; i++) {
+        int bit = cell + i * shift;
+
+        if (0 <= bit && bit < BOARD_WIDTH * BOARD_HEIGHT_1) {
+            line |= (board)1 << bit;
+        }
+    }
+
+    return line & VALID_CELLS;
+}
+
+// Line masks of each cell, indexed by the position of the cell's bit.
+static constexpr auto LINE_MASKS = [] {
+    std::array<LineMasks, BOARD_WIDTH * BOARD_HEIGHT_1> masks{};
+
+    for (int cell = 0; cell < BOARD_WIDTH * BOARD_HEIGHT_1; cell++) {
+        masks[cell] = {line_through_cell(cell, Direction::HORIZONTAL),
+            line_through_cell(cell, Direction::NEGATIVE_DIAGONAL),
+            line_through_cell(cell, Direction::POSITIVE_DIAGONAL)};
+    }
+
+    return masks;
+}();
+
+static inline int get_cell_index(const board cell) noexcept {
+    if constexpr (IS_128_BIT_BOARD) {
+        uint64_t low = static_cast<uint64_t>(cell);
+
+        return low ? std::countr_zero(low) : 64 + std::countr_zero(static_cast<uint64_t>(cell >> 64));
+    } else {
+        return std::countr_zero(static_cast<uint64_t>(cell));
+    }
+}
+
+template <Direction dir>
+static inline board find_threats_on_line(const board b, const board line) noexcept {
+    board stones = b & line;
+
+    // A threat needs three stones on the line.
+    board without_lowest = stones & (stones - 1);
+    if ((without_lowest & (without_lowest - 1)) == 0) {
+        return 0;
+    }
+
+    return find_threats_in_direction<dir>(stones);
+}
+
+// Returns every threat which passes through the given stone, which must be the last stone played
+// by the player. Other threats on the lines through the stone may also be returned.
+static board find_threats_through_stone(const board b, const board stone) noexcept {
+    const LineMasks &lines = LINE_MASKS[get_cell_index(stone)];
+
+    // The stone is on top of its column, so it can only make a vertical threat directly above it.
+    board vertical = ((b << 1) & (b << 2) & stone) << 1;
+
+    return vertical
+        | find_threats_on_line<Direction::HORIZONTAL>(b, lines.horizontal)
+        | find_threats_on_line<Direction::NEGATIVE_DIAGONAL>(b, lines.negative_diagonal)
+        | find_threats_on_line<Direction::POSITIVE_DIAGONAL>(b, lines.positive_diagonal);
+}
+
+#endif
+
 template <Direction dir>
 static board dead_stones_in_direction(const board b0, const board b1) noexcept {
     constexpr int shift = static_cast<int>(dir);
@@ -188,6 +379,12 @@ static board has_won_in_direction(const board b) noexcept {
 }
 
 static bool has_won(const board b) noexcept {
+#ifdef C4_HAS_AVX2_KERNEL
+    if constexpr (USE_AVX2_KERNEL) {
+        return has_won_avx2(b);
+    }
+#endif
+
     return (has_won_in_direction<Direction::VERTICAL>(b) != 0)
         || (has_won_in_direction<Direction::HORIZONTAL>(b) != 0)
         || (has_won_in_direction<Direction::NEGATIVE_DIAGONAL>(b) != 0)
@@ -205,9 +402,17 @@ board Position::move(int col) noexcept {
     board mask = FIRST_COLUMN << (BOARD_HEIGHT_1 * col);
 
     board before_move = b0;
+    board stone = valid_moves & mask;
 
     b0 = b1;
-    b1 = before_move | (valid_moves & mask);
+    b1 = before_move | stone;
+
+#if C4_INCREMENTAL_THREATS
+    // Only the threats of the player who moved can change.
+    board threats = t0 | find_threats_through_stone(b1, stone);
+    t0 = t1;
+    t1 = threats;
+#endif
 
     moves_played++;
 
@@ -244,6 +449,12 @@ board Position::move(board mask) noexcept {
     b0 = b1;
     b1 = before_move | mask;
 
+#if C4_INCREMENTAL_THREATS
+    board threats = t0 | find_threats_through_stone(b1, mask);
+    t0 = t1;
+    t1 = threats;
+#endif
+
     moves_played++;
 
     assert(is_board_valid());
@@ -257,6 +468,12 @@ void Position::unmove(board before_move) noexcept {
     b1 = b0;
     b0 = before_move;
 
+#if C4_INCREMENTAL_THREATS
+    // Threats cannot be taken away one stone at a time, so the player's threats are found again.
+    t1 = t0;
+    t0 = find_threats(b0);
+#endif
+
     moves_played--;
 
     assert(is_board_valid());
@@ -298,7 +515,13 @@ board Position::find_player_threats() const noexcept {
     assert(!is_draw());
 
     // Exclude any threats which the opponent already blocked.
+#if C4_INCREMENTAL_THREATS
+    assert((t0 & VALID_CELLS) == (find_threats(b0) & VALID_CELLS));
+
+    return t0 & ~b1 & VALID_CELLS;
+#else
     return find_threats(b0) & ~b1 & VALID_CELLS;
+#endif
 }
 
 board Position::find_opponent_threats() const noexcept {
@@ -307,7 +530,13 @@ board Position::find_opponent_threats() const noexcept {
     assert(!is_draw());
 
     // Exclude any threats which the opponent already blocked.
+#if C4_INCREMENTAL_THREATS
+    assert((t1 & VALID_CELLS) == (find_threats(b1) & VALID_CELLS));
+
+    return t1 & ~b0 & VALID_CELLS;
+#else
     return find_threats(b1) & ~b0 & VALID_CELLS;
+#endif
 }
 
 board Position::find_next_turn_threats(board threats) const noexcept {
@@ -325,6 +554,34 @@ board Position::find_next_next_turn_threats(board threats) const noexcept {
     return threats & next_next_valid_moves;
 }
 
+void Position::find_move_threats(board opponent_threats, int num_moves, const int *moves,
+        MoveThreats *move_threats) const noexcept {
+    board valid_moves = ((b0 | b1) + BOTTOM_ROW) & VALID_CELLS;
+    board next_valid_moves = (valid_moves << 1) & VALID_CELLS;
+
+    // Threats are only useful in empty cells, which are not directly above a threat of the opponent.
+    board useful_cells = VALID_CELLS & ~b1 & ~(opponent_threats << 1);
+
+    for (int i = 0; i < num_moves; i++) {
+        board move = valid_moves & (FIRST_COLUMN_1 << (BOARD_HEIGHT_1 * moves[i]));
+        assert(move != 0);
+
+        // The move only changes which cells can be played next in its own column.
+        board next_move = (move << 1) & VALID_CELLS;
+        board child_next_valid_moves = (next_valid_moves & ~next_move) | ((next_move << 1) & VALID_CELLS);
+
+#if C4_INCREMENTAL_THREATS
+        board threats = (t0 | find_threats_through_stone(b0 | move, move)) & useful_cells;
+#else
+        board threats = find_threats(b0 | move) & useful_cells;
+#endif
+
+        move_threats[i].useful = threats;
+        move_threats[i].next_turn = threats & child_next_valid_moves;
+        move_threats[i].next_next_turn = threats & (child_next_valid_moves << 1);
+    }
+}
+
 board Position::wins_this_move(board threats) const noexcept {
     board next_valid_moves = (b0 | b1) + BOTTOM_ROW;
 
@@ -442,6 +699,15 @@ int Position::upper_bound_from_evens_strategy() const noexcept {
     return -1;
 }
 
+int Position::column_height(int col) const noexcept {
+    assert(0 <= col && col < BOARD_WIDTH);
+
+    // Stones fill each column from the bottom, so the height is the position of the top stone.
+    board column = ((b0 | b1) >> (BOARD_HEIGHT_1 * col)) & FIRST_COLUMN;
+
+    return std::bit_width(static_cast<uint64_t>(column));
+}
+
 bool Position::is_move_valid(int col) const noexcept {
     assert(0 <= col && col < BOARD_WIDTH);
 
@@ -598,7 +864,30 @@ board Position::find_dead_stones() const noexcept {
     return vertical & horizontal & pos_diag & neg_diag;
 }
 
+// Returns the board with the order of its bytes reversed.
+static inline board reverse_bytes(board b) noexcept {
+#ifdef _MSC_VER
+    return _byteswap_uint64(b);
+#else
+    if constexpr (IS_128_BIT_BOARD) {
+        board low = __builtin_bswap64(static_cast<uint64_t>(b));
+        board high = __builtin_bswap64(static_cast<uint64_t>(b >> 64));
+
+        return (low << 64) | high;
+    } else {
+        return __builtin_bswap64(b);
+    }
+#endif
+}
+
 board Position::mirror(board b) const noexcept {
+    // If every column takes exactly one byte, then reversing the bytes mirrors the board.
+    // Compilers already turn the loop below into a byte swap for 64 bit boards which fill
+    // every byte, but not for narrower or 128 bit boards.
+    if constexpr (BOARD_HEIGHT_1 == 8) {
+        return reverse_bytes(b) >> (8 * (sizeof(board) - BOARD_WIDTH));
+    }
+
     board mirror = 0;
 
     for (int col = 0; col <= (BOARD_WIDTH - 1) / 2; col++) {
@@ -13,6 +13,16 @@ inline static constexpr int score_win_at(const int num_moves) noexcept {
     return 1 + (BOARD_WIDTH * BOARD_HEIGHT - num_moves) / 2;
 }
 
+// The threats a player would have after one of their moves, used to order moves.
+struct MoveThreats {
+    // Threats which are not directly above a threat of the opponent.
+    board useful;
+
+    // The useful threats which could be played on the turn after the move, and the turn after that.
+    board next_turn;
+    board next_next_turn;
+};
+
 class Position {
    public:
     // Returns the first board after a move on top of the given column.
@@ -50,6 +60,11 @@ class Position {
     board find_next_turn_threats(board threats) const noexcept;
     board find_next_next_turn_threats(board threats) const noexcept;
 
+    // Finds the threats the player would have after each of the given moves. Each move only adds
+    // a single stone, so all the work which does not depend on the move is shared.
+    void find_move_threats(board opponent_threats, int num_moves, const int *moves,
+        MoveThreats *move_threats) const noexcept;
+
     // A threat above an opponent's threat is useless and will never win the game.
     inline board find_useful_threats(board player_threats, board opponent_threats) const noexcept {
         return player_threats & ~(opponent_threats << 1);
@@ -72,6 +87,9 @@ class Position {
     // bound on the score of the position.
     int upper_bound_from_evens_strategy() const noexcept;
 
+    // Returns the number of stones in the given column.
+    int column_height(int col) const noexcept;
+
     // Returns true only if the current player is allowed to play the given move.
     bool is_move_valid(int col) const noexcept;
 
@@ -126,6 +144,13 @@ class Position {
     board b0{0};
     board b1{0};
 
+#if C4_INCREMENTAL_THREATS
+    // A 1 in every cell which would complete four in a row for the current and next player,
+    // including cells already taken by the other player.
+    board t0{0};
+    board t1{0};
+#endif
+
     int moves_played{0};
 
     // Returns the input board reflected along the middle column.
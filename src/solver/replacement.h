@@ -0,0 +1,56 @@
+#ifndef REPLACEMENT_H_
+#define REPLACEMENT_H_
+
+#include "entry.h"
+#include "types.h"
+
+// Replacement policies choose which entry in a full bucket is overwritten by a new position.
+// The entry with the lowest keep value is replaced, with ties replacing the first such entry.
+
+// Keeps the entries which took the most work to search.
+struct WorkPreferred {
+    static constexpr const char *NAME = "work";
+
+    static int get_keep_value(Entry entry, int) noexcept { return entry.get_work(); }
+};
+
+// Ignores work, so once a bucket is full new positions keep replacing the same entry
+// until the next epoch, when the entries from older searches are replaced first.
+struct AlwaysReplace {
+    static constexpr const char *NAME = "always";
+
+    static int get_keep_value(Entry entry, int epoch) noexcept { return -entry.get_age(epoch); }
+};
+
+// Keeps exact scores over bounds, and then the entries which took the most work.
+struct ExactPreferred {
+    static constexpr const char *NAME = "exact";
+
+    static int get_keep_value(Entry entry, int) noexcept {
+        int exact_bonus = (entry.get_type() == NodeType::EXACT) ? Entry::max_work() + 1 : 0;
+
+        return exact_bonus + entry.get_work();
+    }
+};
+
+// Keeps the entries which took the most work, but lets unused entries age out. Work is stored
+// on a log scale, so each epoch an entry goes unused costs it the same as a search AGE_PENALTY
+// times smaller.
+struct AgedWorkPreferred {
+    static constexpr const char *NAME = "work+age";
+
+    static int get_keep_value(Entry entry, int epoch) noexcept {
+        constexpr int AGE_PENALTY = 2;
+
+        return entry.get_work() - AGE_PENALTY * entry.get_age(epoch);
+    }
+};
+
+// The replacement benchmark builds the solver once with each policy by defining this macro.
+#ifndef C4_REPLACEMENT_POLICY
+#define C4_REPLACEMENT_POLICY AgedWorkPreferred
+#endif
+
+using DefaultReplacementPolicy = C4_REPLACEMENT_POLICY;
+
+#endif
@@ -1,18 +1,23 @@
 #include "search.h"
 
 #include <algorithm>
+#include <bit>
 #include <cassert>
 
 #include "position.h"
 #include "settings.h"
 #include "table.h"
+#include "util/sorting_network.h"
 
 static constexpr int INF_SCORE = 10000;
 
+// The history of each player is halved once it has counted this many cutoffs.
+static constexpr unsigned int MAX_HISTORY_COUNT = 1 << 16;
+
 static NodeType get_node_type(int value, int alpha, int beta, Entry entry) {
     if (value <= alpha) {
         // Change bound type to exact if we know value <= true score <= value.
-        if (entry.get_type() == NodeType::LOWER && value == entry.get_score()) {
+        if (value == entry.get_lower_bound()) {
             return NodeType::EXACT;
         }
 
@@ -21,7 +26,7 @@ static NodeType get_node_type(int value, int alpha, int beta, Entry entry) {
 
     if (value >= beta) {
         // Similar check to switch to exact bound.
-        if (entry.get_type() == NodeType::UPPER && value == entry.get_score()) {
+        if (value == entry.get_upper_bound()) {
             return NodeType::EXACT;
         }
 
@@ -31,54 +36,123 @@ static NodeType get_node_type(int value, int alpha, int beta, Entry entry) {
     return NodeType::EXACT;
 }
 
+// Uses the popcount instruction if the target has one. Otherwise std::popcount is a library call,
+// which is slower than clearing bits one at a time on the few threats counted here.
 static int count_bits(board b) {
+#if defined(__POPCNT__) || defined(__AVX2__)
+    if constexpr (IS_128_BIT_BOARD) {
+        return std::popcount(static_cast<uint64_t>(b)) + std::popcount(static_cast<uint64_t>(b >> 64));
+    } else {
+        return std::popcount(b);
+    }
+#else
     int result;
     for (result = 0; b; result++) {
         b &= b - 1;
     }
 
     return result;
+#endif
 }
 
-static float heuristic(const Position &pos, board opponent_threats, int col, bool is_table_move) noexcept {
-    // Opponent and player are swapped, since a move was just played.
-    board player_threats = pos.find_opponent_threats();
-    board threats = pos.find_useful_threats(player_threats, opponent_threats);
-
+static float heuristic(const HeuristicWeights &weights, const MoveThreats &threats, int col,
+        bool is_table_move) noexcept {
     float center_score = (float)std::min(col, BOARD_WIDTH - col - 1) / BOARD_WIDTH;
 
     // clang-format off
-    return 1.2f * count_bits(pos.find_next_turn_threats(threats))
-        + 0.5f * is_table_move
-        + 0.5f * count_bits(pos.find_next_next_turn_threats(threats))
-        + 0.3f * count_bits(threats)
-        + 0.1f * center_score;
+    return weights.next_turn_threats * count_bits(threats.next_turn)
+        + weights.table_move * is_table_move
+        + weights.next_next_turn_threats * count_bits(threats.next_next_turn)
+        + weights.threats * count_bits(threats.useful)
+        + weights.center * center_score;
     // clang-format on
 }
 
-void Search::sort_moves(Position &pos, Node *children, board opponent_threats,
+void Search::clear_move_history() noexcept {
+    for (int ply = 0; ply < BOARD_WIDTH * BOARD_HEIGHT; ply++) {
+        killer_moves[ply][0] = -1;
+        killer_moves[ply][1] = -1;
+    }
+
+    for (int player = 0; player < 2; player++) {
+        history_totals[player] = 0;
+
+        for (int cell = 0; cell < BOARD_WIDTH * BOARD_HEIGHT; cell++) {
+            history[player][cell] = 0;
+        }
+    }
+}
+
+static int get_cell(const Position &pos, int col) noexcept {
+    return col * BOARD_HEIGHT + pos.column_height(col);
+}
+
+void Search::update_move_history(const Position &pos, int col) noexcept {
+    int ply = pos.num_moves();
+    int player = ply & 1;
+
+    assert(0 <= ply && ply < BOARD_WIDTH * BOARD_HEIGHT);
+    assert(0 <= col && col < BOARD_WIDTH);
+
+    if (killer_moves[ply][0] != col) {
+        killer_moves[ply][1] = killer_moves[ply][0];
+        killer_moves[ply][0] = col;
+    }
+
+    history[player][get_cell(pos, col)]++;
+    history_totals[player]++;
+
+    // Halve old counts every so often, so the history follows the current part of the search.
+    if (history_totals[player] >= MAX_HISTORY_COUNT) {
+        history_totals[player] = 0;
+
+        for (int cell = 0; cell < BOARD_WIDTH * BOARD_HEIGHT; cell++) {
+            history[player][cell] /= 2;
+            history_totals[player] += history[player][cell];
+        }
+    }
+}
+
+void Search::sort_moves(const Position &pos, Node *children, board opponent_threats,
         int num_moves, int *moves, int score_jitter, int table_move) noexcept {
     assert(num_moves > 0);
     assert(score_jitter >= 0);
     assert(table_move == -1 || (0 <= table_move && table_move < BOARD_WIDTH));
 
+    // Find the threats after every move together, since the moves only differ by a single stone.
+    MoveThreats threats[BOARD_WIDTH];
+    pos.find_move_threats(opponent_threats, num_moves, moves, threats);
+
+    int ply = pos.num_moves();
+    int player = ply & 1;
+
+    // The share of the player's cutoffs caused by a cell is scaled up by the board width, so an
+    // average playable cell has a history score near 1.
+    float history_scale = weights.history * BOARD_WIDTH / (history_totals[player] + 1);
+    bool use_move_history = weights.killer_move > 0 || weights.history > 0;
+
     // Score each valid move by taking a guess on how good the position will be for the player.
     for (int i = 0; i < num_moves; i++) {
         int col = moves[i];
 
-        board before_move = pos.move(col);
-        children[col].score = heuristic(pos, opponent_threats, col, col == table_move);
-        pos.unmove(before_move);
+        children[col].score = heuristic(weights, threats[i], col, col == table_move);
+
+        // Prefer moves which caused cutoffs elsewhere in the tree.
+        if (use_move_history) {
+            bool is_killer_move = (col == killer_moves[ply][0] || col == killer_moves[ply][1]);
+            children[col].score += weights.killer_move * is_killer_move
+                + history_scale * history[player][get_cell(pos, col)];
+        }
 
         // Add some noise to move scores to help threads desync.
         if (score_jitter > 0) {
             int max_rand = 1 + (score_jitter % 10);
-            children[col].score += MOVE_SCORE_JITTER * (dist(rand) % max_rand);
+            children[col].score += weights.jitter * (dist(rand) % max_rand);
         }
     }
 
     // Sort moves according to score, high to low.
-    std::sort(moves, moves + num_moves, [&children](int a, int b) { return children[a].score > children[b].score; });
+    sort_columns_by_score<BOARD_WIDTH>(moves, num_moves, [children](int col) { return children[col].score; });
 }
 
 int Search::search(Position &pos, int alpha, int beta, int score_jitter) {
@@ -92,6 +166,10 @@ int Search::search(Position &pos, int alpha, int beta, int score_jitter) {
     bool is_static = false;
 
     int child_score = static_search(child, alpha, beta, is_static);
+    if (!is_static && child.did_lookup) {
+        child_score = static_lookup(child, alpha, beta, is_static);
+    }
+
     if (is_static) {
         return child_score;
     }
@@ -103,6 +181,32 @@ int Search::search(Position &pos, int alpha, int beta, int score_jitter) {
     }
 }
 
+Entry Search::lookup(const Node &node) noexcept {
+    // Deep positions are most likely to be found in this thread's table, otherwise
+    // they may have been promoted to the shared table.
+    if (node.pos.num_moves() >= LOCAL_TABLE_MIN_PLIES) {
+        Entry entry = local_table.get(node.hash);
+        if (entry.get_type() != NodeType::MISS) {
+            return entry;
+        }
+    }
+
+    return table.get(node.hash);
+}
+
+void Search::store(const Node &node, int move, NodeType type, int value, unsigned long long num_nodes) noexcept {
+    // Only deep positions which took enough work to be worth sharing are written to the shared table.
+    if (node.pos.num_moves() >= LOCAL_TABLE_MIN_PLIES) {
+        local_table.put(node.hash, node.is_mirrored, move, type, value, num_nodes);
+
+        if (num_nodes < MIN_NODES_FOR_SHARED_TABLE) {
+            return;
+        }
+    }
+
+    table.put(node.hash, node.is_mirrored, move, type, value, num_nodes);
+}
+
 int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept {
     assert(alpha < beta);
     assert(!node.pos.is_game_over());
@@ -158,6 +262,11 @@ int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept
     // Moves which cannot be statically evaluated will instead be assigned a score
     // which is a guess of how good the move is. Moves with the highest score will
     // be searched first.
+    //
+    // Static search stops at the table lookup of any child which could not be evaluated
+    // and prefetches its entry, so the lookups of all children are done afterwards once
+    // the entries have had time to arrive from memory.
+    bool is_candidate[BOARD_WIDTH]{};
     for (int col = 0; col < BOARD_WIDTH; col++) {
         if (node.pos.is_non_losing_move(non_losing_moves, col)) {
             bool is_static = false;
@@ -173,6 +282,25 @@ int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept
                 return alpha;
             }
 
+            is_candidate[col] = !is_static;
+        }
+    }
+
+    for (int col = 0; col < BOARD_WIDTH; col++) {
+        if (is_candidate[col]) {
+            bool is_static = false;
+
+            if (children[col].did_lookup) {
+                int child_alpha = -static_lookup(children[col], -beta, -alpha, is_static);
+
+                alpha = std::max(alpha, child_alpha);
+                value = std::max(value, child_alpha);
+
+                if (alpha >= beta) {
+                    return alpha;
+                }
+            }
+
             if (!is_static) {
                 moves[num_moves] = col;
                 num_moves++;
@@ -195,27 +323,25 @@ int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept
     // Check if this state has already been seen.
     int table_move = -1;
     if (!node.did_lookup) {
-        node.entry = table.get(node.hash);
+        node.entry = lookup(node);
     }
-    switch (node.entry.get_type()) {
-        case NodeType::MISS:
-            break;
+    if (!node.entry.is_empty()) {
+        int lower = node.entry.get_lower_bound();
+        int upper = node.entry.get_upper_bound();
 
-        case NodeType::EXACT:
-            return node.entry.get_score();
-
-        case NodeType::LOWER:
-            alpha = std::max(alpha, node.entry.get_score());
-            table_move = node.entry.get_move(node.is_mirrored);
-            break;
+        if (lower >= beta || lower == upper) {
+            return lower;
+        }
+        if (upper <= alpha) {
+            return upper;
+        }
 
-        case NodeType::UPPER:
-            beta = std::min(beta, node.entry.get_score());
-            break;
-    }
+        alpha = std::max(alpha, lower);
+        beta = std::min(beta, upper);
 
-    if (alpha >= beta) {
-        return node.entry.get_score();
+        if (node.entry.get_type() == NodeType::LOWER) {
+            table_move = node.entry.get_move(node.is_mirrored);
+        }
     }
 
     unsigned long long prev_num_nodes = stats->get_num_nodes();
@@ -223,18 +349,34 @@ int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept
     // Sort moves according to score.
     sort_moves(node.pos, children, opponent_threats, num_moves, moves, score_jitter, table_move);
 
+    // Let other threads know this position is being searched.
+    bool is_marked = ENABLE_ABDADA && node.pos.num_moves() < ABDADA_MAX_PLIES;
+    if (is_marked) {
+        marks->mark(node.hash);
+    }
+
     // If none of the above checks pass, then this is an internal node and we must
     // evaluate the child nodes to determine the score of this node.
     int best_recursion_value = -INF_SCORE, best_move_col = -1;
+    int num_deferred_moves = 0;
     for (int i = 0; i < num_moves && alpha < beta; i++) {
         int col = moves[i];
 
+        // With ABDADA, moves after the first which another thread is searching are moved to the
+        // end, so this thread searches a different subtree first. Each move is deferred once.
+        if (is_marked && i > 0 && i < num_moves - num_deferred_moves && is_searched_elsewhere(children[col])) {
+            std::rotate(moves + i, moves + i + 1, moves + num_moves);
+            num_deferred_moves++;
+            i--;
+            continue;
+        }
+
         int child_score_jitter = score_jitter / 10;
 
         // If the difference in score between this move and the next & previous moves is too
         // large to be affected by score jitter, then pass the move jitter on to the child.
-        if ((i == 0 || children[moves[i - 1]].score > children[col].score + MOVE_SCORE_JITTER) &&
-            (i == num_moves - 1 || children[moves[i + 1]].score < children[col].score - MOVE_SCORE_JITTER)) {
+        if ((i == 0 || children[moves[i - 1]].score > children[col].score + weights.jitter) &&
+            (i == num_moves - 1 || children[moves[i + 1]].score < children[col].score - weights.jitter)) {
             child_score_jitter = score_jitter;
         }
 
@@ -246,6 +388,10 @@ int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept
 
         // If the child aborted the search, propagate the signal upwards.
         if (abs(child_score) == SEARCH_STOPPED) {
+            if (is_marked) {
+                marks->unmark(node.hash);
+            }
+
             return SEARCH_STOPPED;
         }
 
@@ -256,9 +402,17 @@ int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept
 
             value = std::max(value, child_score);
             alpha = std::max(alpha, child_score);
+
+            if (alpha >= beta && (weights.killer_move > 0 || weights.history > 0)) {
+                update_move_history(node.pos, col);
+            }
         }
     }
 
+    if (is_marked) {
+        marks->unmark(node.hash);
+    }
+
     assert(best_recursion_value != -INF_SCORE);
     assert(best_move_col != -1);
     assert(alpha >= value);
@@ -267,7 +421,7 @@ int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept
     // Store the result in the transposition table.
     NodeType type = get_node_type(value, original_alpha, original_beta, node.entry);
     unsigned long long num_child_nodes = stats->get_num_nodes() - prev_num_nodes;
-    table.put(node.hash, node.is_mirrored, best_move_col, type, value, num_child_nodes);
+    store(node, best_move_col, type, value, num_child_nodes);
 
     // Update statistics.
     stats->new_interior_node(type);
@@ -284,6 +438,19 @@ int Search::negamax(Node &node, int alpha, int beta, int score_jitter) noexcept
     return value;
 }
 
+bool Search::is_searched_elsewhere(const Node &child) const noexcept {
+    // Deeper positions are never marked.
+    if (child.pos.num_moves() >= ABDADA_MAX_PLIES) {
+        return false;
+    }
+
+    // The hash is only known if static search stopped at the child's table lookup.
+    bool is_mirrored;
+    board hash = child.did_lookup ? child.hash : child.pos.hash(is_mirrored);
+
+    return marks->is_marked(hash);
+}
+
 int Search::static_search(Node &node, int alpha, int beta, bool &is_static) noexcept {
     assert(alpha < beta);
     assert(!is_static);
@@ -325,6 +492,7 @@ int Search::static_search(Node &node, int alpha, int beta, bool &is_static) noex
     board forced_move = node.pos.find_forced_move(opponent_wins, non_losing_moves);
     if (forced_move) {
         node.pos.move(forced_move);
+        node.num_forced_moves++;
         int child_score = -static_search(node, -beta, -alpha, is_static);
 
         if (is_static) {
@@ -346,38 +514,63 @@ int Search::static_search(Node &node, int alpha, int beta, bool &is_static) noex
         }
     }
 
-    // If we do not have a forced move then this position cannot be statically evaluated.
-    // Do a table lookup to see if we can tighten search bounds.
+    // If we do not have a forced move then this position cannot be statically evaluated. A table
+    // lookup may still tighten search bounds, so prefetch the entry and leave the lookup to
+    // static_lookup, which is called once the entries of all sibling positions are prefetched.
     if (node.pos.num_moves() < ENHANCED_TABLE_CUTOFF_PLIES) {
         node.did_lookup = true;
         node.hash = node.pos.hash(node.is_mirrored);
+        node.lookup_alpha = alpha;
+        node.lookup_beta = beta;
 
-        // Check if this state has already been seen.
-        node.entry = table.get(node.hash);
+        table.prefetch(node.hash);
+    }
 
-        switch (node.entry.get_type()) {
-            case NodeType::MISS:
-                break;
+    return INF_SCORE;
+}
 
-            case NodeType::EXACT:
-                is_static = true;
-                return node.entry.get_score();
+int Search::static_lookup(Node &node, int alpha, int beta, bool &is_static) noexcept {
+    assert(node.did_lookup);
+    assert(!is_static);
 
-            case NodeType::LOWER:
-                alpha = std::max(alpha, node.entry.get_score());
-                if (alpha >= beta) {
-                    is_static = true;
-                    return node.entry.get_score();
-                }
-                break;
+    // The bounds are given for the position static search started from. Each forced move
+    // played since then swaps the player to move, and so the sign of the score.
+    int sign = (node.num_forced_moves & 1) ? -1 : 1;
+    if (sign < 0) {
+        std::swap(alpha, beta);
+        alpha = -alpha;
+        beta = -beta;
+    }
 
-            case NodeType::UPPER:
-                beta = std::min(beta, node.entry.get_score());
-                if (alpha >= beta) {
-                    is_static = true;
-                    return node.entry.get_score();
-                }
-                return beta;
+    // Bounds found by static search still apply, and the bounds of the parent may have tightened
+    // since static search ran.
+    alpha = std::max(alpha, node.lookup_alpha);
+    beta = std::min(beta, node.lookup_beta);
+    if (alpha >= beta) {
+        is_static = true;
+        return sign * beta;
+    }
+
+    // Check if this state has already been seen.
+    node.entry = lookup(node);
+
+    if (!node.entry.is_empty()) {
+        int lower = node.entry.get_lower_bound();
+        int upper = node.entry.get_upper_bound();
+
+        if (lower >= beta || lower == upper) {
+            is_static = true;
+            return sign * lower;
+        }
+        if (upper <= alpha) {
+            is_static = true;
+            return sign * upper;
+        }
+
+        // Only an upper bound tightens the parent's bounds, and only if the position is a
+        // direct child of the parent.
+        if (upper < Position::MAX_SCORE && node.num_forced_moves == 0) {
+            return std::min(beta, upper);
         }
     }
 
@@ -3,6 +3,8 @@
 
 #include <random>
 
+#include "local_table.h"
+#include "marks.h"
 #include "position.h"
 #include "table.h"
 #include "util/progress.h"
@@ -20,28 +22,72 @@ struct Node {
     board hash{0};
     Entry entry{};
 
+    // If static search stopped at a table lookup, these are the forced moves it played and
+    // the bounds it found for the position, so the lookup can be finished later.
+    int num_forced_moves{0};
+    int lookup_alpha{0};
+    int lookup_beta{0};
+
     Node() = default;
 
     Node(const Position &pos) : pos(pos) {};
 };
 
+// Weights of the guesses used to order moves. Unlike the settings, these can be changed between
+// searches, which lets the weights be tuned without recompiling.
+struct HeuristicWeights {
+    // Threats after the move which can be played after one or two more moves in their column.
+    float next_turn_threats{1.2f};
+    float next_next_turn_threats{0.5f};
+
+    // All threats after the move which are not directly above a threat of the opponent.
+    float threats{0.3f};
+
+    // The best move stored in the table by an earlier search.
+    float table_move{0.5f};
+
+    // Moves closer to the center column.
+    float center{0.1f};
+
+    float killer_move{KILLER_MOVE_WEIGHT};
+    float history{HISTORY_WEIGHT};
+
+    // Only used when running with more than one search thread.
+    float jitter{MOVE_SCORE_JITTER};
+};
+
 // A single threaded search.
 class Search {
    public:
     // Create our own copy of the transposition table. This table will use the same
     // underlying storage as parent_table so this thread can benefit from the work
     // other threads have saved in the table.
-    Search(int id, const Table &parent_table, std::shared_ptr<Stats> stats, std::shared_ptr<Progress> progress)
-        : table(parent_table, stats), stats(std::move(stats)), progress(std::move(progress)), rand(id) {}
+    Search(int id, const Table &parent_table, std::shared_ptr<SearchMarks> marks, std::shared_ptr<Stats> stats,
+           std::shared_ptr<Progress> progress)
+        : table(parent_table, stats), marks(std::move(marks)), stats(std::move(stats)), local_table(this->stats),
+          progress(std::move(progress)), rand(id) {
+        clear_move_history();
+    }
 
     void start() { stop_search = false; }
+    void clear_local_table() { local_table.clear(); }
+    void clear_move_history() noexcept;
     void stop() { stop_search = true; }
+    void set_weights(const HeuristicWeights &new_weights) noexcept { weights = new_weights; }
 
     int search(Position &pos, int alpha, int beta, int score_jitter);
 
    private:
     Table table;
+
+    // The positions being searched by all threads, used by ABDADA.
+    std::shared_ptr<SearchMarks> marks;
+
     std::shared_ptr<Stats> stats;
+
+    // Positions deep in the search tree are kept in a table private to this thread.
+    LocalTable local_table;
+
     std::shared_ptr<Progress> progress;
 
     std::mt19937 rand;
@@ -49,11 +95,26 @@ class Search {
 
     bool stop_search{false};
 
+    HeuristicWeights weights{};
+
+    // Moves which caused cutoffs. The killer moves are the last two columns to cause a cutoff
+    // after each number of moves played, and the history counts the cutoffs caused by each
+    // player moving into each cell.
+    int killer_moves[BOARD_WIDTH * BOARD_HEIGHT][2];
+    unsigned int history[2][BOARD_WIDTH * BOARD_HEIGHT];
+    unsigned int history_totals[2];
+
+    Entry lookup(const Node &node) noexcept;
+    void store(const Node &node, int move, NodeType type, int value, unsigned long long num_nodes) noexcept;
+
     int negamax(Node &node, int alpha, int beta, int score_jitter) noexcept;
+    bool is_searched_elsewhere(const Node &child) const noexcept;
 
-    void sort_moves(Position &pos, Node *children, board opponent_threats,
+    void update_move_history(const Position &pos, int col) noexcept;
+    void sort_moves(const Position &pos, Node *children, board opponent_threats,
         int num_moves, int *moves, int score_jitter, int table_move) noexcept;
     int static_search(Node &node, int alpha, int beta, bool &is_static) noexcept;
+    int static_lookup(Node &node, int alpha, int beta, bool &is_static) noexcept;
 };
 
 #endif
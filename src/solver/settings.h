@@ -6,42 +6,119 @@
 // Defines settings which can be tuned for the target machine and target problem.
 // In rough order of importance.
 
-// The shape of the board.
-inline constexpr int BOARD_WIDTH = 7;
-inline constexpr int BOARD_HEIGHT = 6;
+// The shape of the board. The tests are also built for a 4x7 board by defining these macros.
+#ifndef C4_BOARD_WIDTH
+#define C4_BOARD_WIDTH 7
+#endif
+#ifndef C4_BOARD_HEIGHT
+#define C4_BOARD_HEIGHT 6
+#endif
+
+inline constexpr int BOARD_WIDTH = C4_BOARD_WIDTH;
+inline constexpr int BOARD_HEIGHT = C4_BOARD_HEIGHT;
 
 // Number of search threads. If 0, the number concurrent threads available on the machine is used.
 inline constexpr int NUM_THREADS = 0;
 
-// This setting controls the amount of memory the solver is allowed to use. Increasing the number
-// of entries will reduce solve times significantly.
+// Number of null windows the root search probes at the same time. The search threads are split into
+// this many groups, and each group searches a different window next to the current guess, sharing
+// the table. The bounds are narrowed by whichever probe finishes first, and groups whose window is
+// no longer needed move on to a new one. If 1, every thread searches the same window.
+inline constexpr int NUM_WINDOW_PROBES = 1;
+
+// This setting controls the amount of memory the solver is allowed to use. Increasing the size
+// of the table will reduce solve times significantly.
 //
-// The transposition table uses the Chinese Remainer Theorem to reduce the number of bits per entry.
-// For this to work, the size of the table must be odd. The size of the table should be a prime
-// number for fewer collisions.
+// The size can be changed at startup without recompiling by setting the environment variable
+// C4_TABLE_SIZE, either to an amount of memory such as "512MB" or "32GB", or to a percentage of
+// the machine's physical memory such as "75%".
 //
-// Some example prime numbers for table sizes, with the memory requirements:
-//  * 8388617    : 64 MB
-//  * 134217757  :  1 GB
-//  * 1073741827 :  8 GB
-//  * 4294967311 : 32 GB
-//  * 6442450967 : 48 GB
-//  * 7247757317 : 54 GB
-inline constexpr uint64_t NUM_TABLE_ENTRIES = 134217757;
-
-// Enable 2 MB pages, instead of 4 KB. Not implemented for Macs.
+// The table is split into 64 byte buckets, one per cache line, with 8 entries in each bucket.
+// The number of buckets is chosen at startup as the largest prime number which fits in the
+// requested memory. Large boards need a minimum table size for the entries to stay unique (see
+// the readme). Asking for less is an error, unless C4_TABLE_GROW is set to use the minimum size.
+inline constexpr const char *DEFAULT_TABLE_SIZE = "1GB";
+
+// Fix the number of buckets at compile time instead of choosing it at startup, in which case the table
+// size settings are ignored. Must be odd, and is best prime. On boards which fit in 64 bits, hashes are
+// then reduced to a bucket index with a division by a constant, which the compiler replaces with
+// faster multiplications. If 0, the number of buckets is chosen at startup.
+inline constexpr uint64_t FIXED_TABLE_BUCKETS = 0;
+
+// The table is kept in memory unless this is set to a directory on a fast disk, such as an NVMe
+// drive. The table is then backed by a temporary file in that directory, which allows a table
+// larger than physical memory at the cost of slower lookups once the table no longer fits in
+// memory. Can also be set at startup with the environment variable C4_TABLE_DIR.
+inline constexpr const char *DEFAULT_TABLE_DIR = "";
+
+// Enable 2 MB pages, instead of 4 KB. Not implemented for Macs. On Linux, pages reserved in the
+// kernel's huge page pool (vm.nr_hugepages) are used first, including 1 GB pages for large tables,
+// then transparent huge pages. The settings line shows which pages the table ended up on.
 inline constexpr bool ENABLE_HUGE_PAGES = false;
 
-// Restrict each search thread to a single core. Only implemented on Windows.
+// Spread the table evenly across the memory of every NUMA node, so all search threads see the same
+// average latency instead of threads on other nodes paying for remote memory on every lookup.
+// Only implemented on Linux, and has no effect on machines with a single node.
+inline constexpr bool ENABLE_NUMA_INTERLEAVE = true;
+
+// Sample table lookups to count how many were to memory on the same NUMA node as the searching
+// thread. Only implemented on Linux.
+inline constexpr bool ENABLE_NUMA_STATS = false;
+
+// Restrict each search thread to a single core. Only implemented on Windows and Linux. On Linux,
+// threads are placed on separate physical cores before sharing a core with an SMT sibling, and
+// either fill one socket before moving to the next, or alternate between sockets if
+// AFFINITY_SPREAD_SOCKETS is set.
 inline constexpr bool ENABLE_AFFINITY = false;
+inline constexpr bool AFFINITY_SPREAD_SOCKETS = false;
+
+// Positions at least this many moves deep are stored in a small table private to each search
+// thread, which is sized to stay in the core's cache. Results which took at least
+// MIN_NODES_FOR_SHARED_TABLE nodes to compute are also written to the shared table, so other
+// threads can use them. Set above the number of cells on the board to only use the shared table.
+inline constexpr int LOCAL_TABLE_MIN_PLIES = BOARD_WIDTH * BOARD_HEIGHT - 12;
+inline constexpr int LOCAL_TABLE_SIZE = 256 * 1024;
+inline constexpr unsigned long long MIN_NODES_FOR_SHARED_TABLE = 8;
 
 // At depths higher than this value, the search will do a transposition table
 // lookup for each child in hope of tightening bounds or finding a cut off.
 inline constexpr int ENHANCED_TABLE_CUTOFF_PLIES = BOARD_WIDTH * BOARD_HEIGHT - 15;
 
+// Keep the threats of both players in each position, instead of finding them on the whole board
+// every time they are needed. Each move only looks for new threats on the lines through the new
+// stone, and move ordering finds the threats after each move the same way. Undoing a move finds the
+// threats of the player again. The bench target builds the solver both ways by defining
+// C4_INCREMENTAL_THREATS.
+#ifndef C4_INCREMENTAL_THREATS
+#define C4_INCREMENTAL_THREATS false
+#endif
+inline constexpr bool ENABLE_INCREMENTAL_THREATS = C4_INCREMENTAL_THREATS;
+
+// On boards larger than 64 bits, find threats and wins in all four directions at once with AVX2
+// instead of one direction after another on 128 bit integers. Only has an effect if the solver is
+// compiled with AVX2 enabled, such as with the ENABLE_AVX2 CMake option.
+inline constexpr bool ENABLE_AVX2_KERNEL = true;
+
+// Moves are ordered by a guess at how good they are for the player, and these weights add bonuses
+// for moves which caused cutoffs elsewhere in the tree. Killer moves are the last two columns to
+// cause a cutoff after the same number of moves, and the history bonus is scaled by how often
+// the player caused a cutoff by moving into the same cell. Both bonuses have to stay below the
+// threat and center scores to not grow the tree, and even as tie breakers they did not reduce
+// the nodes searched on the 7x6 test suites, so both are disabled by default.
+inline constexpr float KILLER_MOVE_WEIGHT = 0.0f;
+inline constexpr float HISTORY_WEIGHT = 0.0f;
+
+// Threads normally all search the same tree and only drift apart through the score jitter below
+// (lazy SMP). With ABDADA, threads instead mark the positions they are searching, and search the
+// moves which another thread is already searching after the others, except for the first move. This
+// spreads the threads across the tree without jitter. Only positions fewer than ABDADA_MAX_PLIES moves
+// deep are marked, as deeper subtrees are too small to be worth sharing.
+inline constexpr bool ENABLE_ABDADA = false;
+inline constexpr int ABDADA_MAX_PLIES = BOARD_WIDTH * BOARD_HEIGHT - 20;
+
 // Determines how much noise to add to move scores near the root of the search tree
 // when searching with multiple threads. This noise helps threads to desync.
-// Only used when running with more than one search thread.
+// Only used when running with more than one search thread, and not with ABDADA.
 inline constexpr float MOVE_SCORE_JITTER = 0.3f;
 
 // Whether an opening book should be read into the transposition table before solving any positions.
@@ -53,6 +130,14 @@ inline constexpr unsigned long long MIN_NODES_FOR_TABLE_FILE = 1 * 1000 * 1000;
 inline constexpr bool LOAD_TABLE_FILE = false;
 inline constexpr bool UPDATE_TABLE_FILE = false;
 
+// Snapshots are binary copies of the whole table, saved to data/table-WxH.bin once a solve is complete.
+// Loading a snapshot at startup lets a long analysis be resumed. The file is mapped into memory, so
+// only the parts of the table which are used are read from disk, and the table keeps the size it
+// was saved with.
+inline constexpr bool LOAD_TABLE_SNAPSHOT = false;
+inline constexpr bool SAVE_TABLE_SNAPSHOT = false;
+
 static_assert(!(LOAD_BOOK_FILE && LOAD_TABLE_FILE), "Cannot load an opening book and a table file.");
+static_assert(FIXED_TABLE_BUCKETS % 2 == 1 || FIXED_TABLE_BUCKETS == 0, "The number of buckets must be odd.");
 
 #endif
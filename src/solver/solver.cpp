@@ -1,5 +1,6 @@
 #include "solver.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
 #include <iostream>
@@ -12,6 +13,7 @@
 #include "position.h"
 #include "settings.h"
 #include "table.h"
+#include "util/os.h"
 
 Solver::Solver()
     : table(), pool(table, progress) {
@@ -35,11 +37,19 @@ int Solver::solve_weak(const Position &pos) {
     }
 }
 
-int Solver::solve_strong(const Position &pos) {
-    return solve(pos, Position::MIN_SCORE, Position::MAX_SCORE);
+int Solver::solve_strong(const Position &pos, std::optional<int> guess) {
+    return solve(pos, Position::MIN_SCORE, Position::MAX_SCORE, guess);
 }
 
-int Solver::solve(const Position &pos, int lower, int upper) {
+int Solver::solve(const Position &pos, int lower, int upper, std::optional<int> guess) {
+    // Age entries left by earlier solves, so they are the first to be replaced. This must come
+    // before the guess is read, since reading the root entry moves it to the current epoch.
+    table.next_epoch();
+
+    return solve_in_current_epoch(pos, lower, upper, guess);
+}
+
+int Solver::solve_in_current_epoch(const Position &pos, int lower, int upper, std::optional<int> guess) {
     assert(lower < upper);
 
     // Check if the game is already over before launching the full search.
@@ -70,8 +80,15 @@ int Solver::solve(const Position &pos, int lower, int upper) {
 
     int alpha = std::max(lower, min_score);
     int beta = std::min(upper, max_score);
-    int score = (alpha + beta) / 2;
+    int score = get_first_guess(pos, alpha, beta, guess);
 
+    // With window probing, the pool runs the steps below in parallel.
+    if (pool.get_num_probes() > 1) {
+        return pool.probe_windows(pos, alpha, beta, score);
+    }
+
+    // Each null window search moves one bound to the score it returned, so the search steps
+    // from the first guess towards the true score.
     while (alpha < beta) {
         int window = std::max(score, alpha + 1);
         score = pool.search(pos, window - 1, window);
@@ -86,6 +103,20 @@ int Solver::solve(const Position &pos, int lower, int upper) {
     return score;
 }
 
+int Solver::get_first_guess(const Position &pos, int alpha, int beta, std::optional<int> guess) {
+    bool is_mirrored;
+    Entry entry = table.get(pos.hash(is_mirrored));
+
+    if (!guess.has_value()) {
+        guess = (entry.get_type() == NodeType::EXACT) ? entry.get_score() : (alpha + beta) / 2;
+    }
+
+    // The true score is within the bounds stored in the table, so never guess outside them.
+    int score = std::clamp(*guess, entry.get_lower_bound(), entry.get_upper_bound());
+
+    return std::clamp(score, alpha, beta);
+}
+
 int Solver::get_best_move(const Position &pos_orig, int score) {
     assert(!pos_orig.is_game_over());
 
@@ -104,14 +135,9 @@ int Solver::get_best_move(const Position &pos_orig, int score) {
     if (entry.get_type() != NodeType::MISS) {
         int table_move = entry.get_move(is_mirrored);
 
-        // Validate the move stored in the table is the best move.
-        board before_move = pos.move(table_move);
-        int table_score = -solve(pos, -score, -score + 1);
-        pos.unmove(before_move);
-
         // The table doesn't always store the best move to play. If this is the case,
         // Try every move until we find the best move.
-        if (table_score >= score) {
+        if (is_best_move(pos, table_move, score)) {
             return table_move;
         }
     }
@@ -119,14 +145,8 @@ int Solver::get_best_move(const Position &pos_orig, int score) {
     // If we still have a miss, then try each move until we find a move which
     // gives the same score as the position.
     for (int move = 0; move < BOARD_WIDTH; move++) {
-        if (pos.is_move_valid(move)) {
-            board before_move = pos.move(move);
-            int child_score = -solve(pos, -score, -score + 1);
-            pos.unmove(before_move);
-
-            if (child_score >= score) {
-                return move;
-            }
+        if (pos.is_move_valid(move) && is_best_move(pos, move, score)) {
+            return move;
         }
     }
 
@@ -138,6 +158,15 @@ int Solver::get_best_move(const Position &pos_orig, int score) {
     return -1;
 }
 
+bool Solver::is_best_move(const Position &pos, int move, int score) {
+    assert(pos.is_move_valid(move));
+
+    Position child{pos};
+    child.move(move);
+
+    return -solve_in_current_epoch(child, -score, -score + 1) >= score;
+}
+
 int Solver::get_principal_variation(const Position &pos, std::vector<int> &moves) {
     assert(moves.size() == 0);
 
@@ -157,22 +186,53 @@ int Solver::get_principal_variation(const Position &pos, std::vector<int> &moves
 }
 
 void Solver::clear_state() {
-    table.clear();
+    pool.clear_table();
     pool.reset_stats();
 }
 
+void Solver::save_table_snapshot() {
+    if constexpr (SAVE_TABLE_SNAPSHOT) {
+        table.save_snapshot();
+    }
+}
+
 std::string Solver::get_settings_string() { 
     std::stringstream result;
     result << "Using a " << BOARD_WIDTH << " x " << BOARD_HEIGHT << " board";
 
-    result << ", a " << Table::get_table_size() << " table";
+    result << ", a " << table.get_table_size() << " table";
+    if (table.is_file_backed()) {
+        result << " (file backed)";
+    }
     if (ENABLE_HUGE_PAGES) {
-        result << " (huge pages on)";
+        PageUsage usage = table.get_page_usage();
+
+        // Reserved huge pages are used for the whole table, while transparent huge pages are
+        // only known once the table is in use.
+        if (usage.page_size >= 1024 * 1024 * 1024) {
+            result << " (on 1 GB huge pages)";
+        } else if (usage.page_size >= 2 * 1024 * 1024) {
+            result << " (on 2 MB huge pages)";
+        } else if (usage.resident_bytes > 0) {
+            result << " (" << std::fixed << std::setprecision(0)
+                   << 100.0 * usage.huge_page_bytes / usage.resident_bytes << "% on huge pages)";
+        } else {
+            result << " (huge pages on)";
+        }
+    }
+    if (ENABLE_NUMA_INTERLEAVE && !table.is_file_backed() && get_num_numa_nodes() > 1) {
+        result << " (interleaved across " << get_num_numa_nodes() << " NUMA nodes)";
     }
         
     result << ", and " << pool.get_num_workers() << " threads";
+    if (ENABLE_ABDADA && pool.get_num_workers() > 1) {
+        result << " (ABDADA)";
+    }
+    if (pool.get_num_probes() > 1) {
+        result << " (probing " << pool.get_num_probes() << " windows at once)";
+    }
     if (ENABLE_AFFINITY) {
-        result << " (affinity on)";
+        result << (AFFINITY_SPREAD_SOCKETS ? " (affinity on, spread across sockets)" : " (affinity on)");
     }
 
     result << "." << std::endl;
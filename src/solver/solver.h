@@ -1,8 +1,9 @@
 #ifndef SOLVER_H_
 #define SOLVER_H_
 
-#include <string>
 #include <memory>
+#include <optional>
+#include <string>
 
 #include "parallel/pool.h"
 #include "position.h"
@@ -16,22 +17,40 @@ class Solver {
     Solver(const Solver &solver);
 
     int solve_weak(const Position &pos);
-    int solve_strong(const Position &pos);
-    int solve(const Position &pos, int lower, int upper);
+
+    // Solves the position within the given bounds. The search starts from the guess if one
+    // is given, such as the negated score of the position before the last move, and
+    // otherwise from the score stored in the table. A close guess needs fewer searches.
+    int solve_strong(const Position &pos, std::optional<int> guess = std::nullopt);
+    int solve(const Position &pos, int lower, int upper, std::optional<int> guess = std::nullopt);
 
     void cancel() { pool.cancel(); }
 
+    // Finds moves which keep the score of a position which was just solved. These searches are
+    // part of the last solve, so they do not age the table like solve() does.
     int get_best_move(const Position &pos, int score);
+    bool is_best_move(const Position &pos, int move, int score);
     int get_principal_variation(const Position &pos, std::vector<int> &moves);
 
     const Stats &get_merged_stats() const { return pool.get_merged_stats(); }
     void clear_state();
 
+    // Change the weights used to order moves in all future searches.
+    void set_heuristic_weights(const HeuristicWeights &weights) { pool.set_weights(weights); }
+
+    int get_num_threads() { return pool.get_num_workers(); }
+
+    // Saves the table to the snapshot file if SAVE_TABLE_SNAPSHOT is set.
+    void save_table_snapshot();
+
     void print_progress() { progress->print_progress(); }
 
     std::string get_settings_string();
 
    private:
+    int solve_in_current_epoch(const Position &pos, int lower, int upper, std::optional<int> guess = std::nullopt);
+    int get_first_guess(const Position &pos, int alpha, int beta, std::optional<int> guess);
+
     std::shared_ptr<Progress> progress{std::make_shared<Progress>()};
     
     // Every worker will make a copy of this table. This will give
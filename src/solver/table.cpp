@@ -2,18 +2,25 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <sstream>
 #include <string>
 #include <stdexcept>
+#include <system_error>
+#include <vector>
 
 #include "position.h"
 #include "settings.h"
+#include "util/fastmod.h"
 #include "util/os.h"
 
 static std::filesystem::path get_table_filepath() {
@@ -28,49 +35,305 @@ static std::filesystem::path get_book_filepath() {
     return "data" / std::filesystem::path(name);
 }
 
-Table::Table() {
-    // Need to allocate +1 entries since each entry can access the next entry.
-    Entry *memory = static_cast<Entry *>(allocate_huge_pages(NUM_TABLE_ENTRIES + 1, sizeof(Entry)));
-    auto memory_free = [](Entry *memory) { free_huge_pages(memory); };
+// Formats a line of the table file. 128 bit hashes are written as two 64 bit numbers.
+static std::string format_table_line(board hash, int move, NodeType type, int score, unsigned long long num_nodes) {
+    std::string line;
+    if constexpr (IS_128_BIT_BOARD) {
+        line = std::to_string(static_cast<uint64_t>(hash >> 64)) + ","
+            + std::to_string(static_cast<uint64_t>(hash)) + ",";
+    } else {
+        line = std::to_string(static_cast<uint64_t>(hash)) + ",";
+    }
+
+    return line
+        + std::to_string(move) + ","
+        + std::to_string(static_cast<int>(type)) + ","
+        + std::to_string(score) + ","
+        + std::to_string(num_nodes);
+}
+
+static board parse_table_hash(const std::string &hash1_string, const std::string &hash2_string) {
+    if constexpr (IS_128_BIT_BOARD) {
+        board hash1 = static_cast<board>(std::stoull(hash1_string));
+        board hash2 = static_cast<board>(std::stoull(hash2_string));
+
+        return (hash1 << 64) | hash2;
+    } else {
+        return std::stoull(hash1_string);
+    }
+}
 
-    this->table = std::shared_ptr<Entry[]>(memory, memory_free);
-    this->stats = std::make_shared<Stats>();
-    
-    // Create the writer which will share significant results found by any search thread.
-    this->table_writer = std::make_shared<Writer>(get_table_filepath());
+template <class Policy>
+std::filesystem::path BasicTable<Policy>::get_snapshot_filepath() {
+    std::string name = "table-" + std::to_string(BOARD_WIDTH) + "x" + std::to_string(BOARD_HEIGHT) + ".bin";
 
-    // Set all entries to empty.
-    clear();
+    return "data" / std::filesystem::path(name);
 }
 
-void Table::clear() {
-    Entry empty{};
-    std::fill(table.get(), table.get() + NUM_TABLE_ENTRIES + 1, empty);
+// Snapshots start with this header, followed by the raw buckets. The header is padded so the
+// buckets can be mapped straight from the file, since a mapping must start on a page boundary
+// (or on a 64 KB boundary on Windows).
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t board_width;
+    uint32_t board_height;
+    uint32_t bucket_size;
+    uint64_t entry_layout;
+    uint64_t num_buckets;
+    uint32_t epoch;
+};
+
+static constexpr char SNAPSHOT_MAGIC[8] = {'C', '4', 'T', 'A', 'B', 'L', 'E', '\0'};
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+static constexpr size_t SNAPSHOT_HEADER_SIZE = 64 * 1024;
+
+static_assert(sizeof(SnapshotHeader) <= SNAPSHOT_HEADER_SIZE);
+
+static SnapshotHeader make_snapshot_header(uint64_t num_buckets, int epoch) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.board_width = BOARD_WIDTH;
+    header.board_height = BOARD_HEIGHT;
+    header.bucket_size = sizeof(Bucket);
+    header.entry_layout = Entry::get_layout();
+    header.num_buckets = num_buckets;
+    header.epoch = epoch;
+
+    return header;
 }
 
-void Table::prefetch(board hash) const noexcept {
-    assert(hash != 0);
+// Returns true if the snapshot was saved by a build which stores entries the same way as this one.
+static bool is_snapshot_compatible(const SnapshotHeader &header) {
+    SnapshotHeader expected = make_snapshot_header(header.num_buckets, header.epoch);
+
+    return std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0
+        && header.version == expected.version
+        && header.board_width == expected.board_width
+        && header.board_height == expected.board_height
+        && header.bucket_size == expected.bucket_size
+        && header.entry_layout == expected.entry_layout;
+}
+
+// Parses a size such as "512MB", "32GB", or "75%" of physical memory into a number of bytes.
+// Returns 0 if the size is not valid.
+static uint64_t parse_table_size(const std::string &size) {
+    size_t end;
+    double amount;
+    try {
+        amount = std::stod(size, &end);
+    } catch (std::exception const &) {
+        return 0;
+    }
+
+    std::string unit = size.substr(end);
+    std::transform(unit.begin(), unit.end(), unit.begin(), [](unsigned char c) { return std::toupper(c); });
+
+    double multiplier;
+    if (unit == "%") {
+        multiplier = get_physical_memory() / 100.0;
+    } else if (unit == "KB") {
+        multiplier = 1ull << 10;
+    } else if (unit == "MB") {
+        multiplier = 1ull << 20;
+    } else if (unit == "GB") {
+        multiplier = 1ull << 30;
+    } else if (unit == "TB") {
+        multiplier = 1ull << 40;
+    } else if (unit == "" || unit == "B") {
+        multiplier = 1;
+    } else {
+        return 0;
+    }
+
+    return (amount > 0) ? static_cast<uint64_t>(amount * multiplier) : 0;
+}
+
+static uint64_t get_table_size_setting() {
+    const char *env_size = std::getenv("C4_TABLE_SIZE");
+    if (env_size) {
+        uint64_t num_bytes = parse_table_size(env_size);
+        if (num_bytes) {
+            return num_bytes;
+        }
+
+        std::cerr << "Could not parse C4_TABLE_SIZE=\"" << env_size << "\". Using the default table size of "
+                  << DEFAULT_TABLE_SIZE << "." << std::endl;
+    }
+
+    return parse_table_size(DEFAULT_TABLE_SIZE);
+}
+
+static std::filesystem::path get_table_dir_setting() {
+    const char *env_dir = std::getenv("C4_TABLE_DIR");
+
+    return (env_dir) ? env_dir : DEFAULT_TABLE_DIR;
+}
+
+static bool is_prime(uint64_t n) {
+    if (n < 2) {
+        return false;
+    }
+
+    for (uint64_t i = 2; i * i <= n; i++) {
+        if (n % i == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns the number of buckets to use in a table of the given size. The number of buckets
+// must be odd for the partial hashes to be unique, and is prime for fewer collisions.
+static uint64_t choose_num_buckets(uint64_t num_bytes) {
+    if constexpr (FIXED_TABLE_BUCKETS != 0) {
+        return FIXED_TABLE_BUCKETS;
+    }
+
+    uint64_t min_buckets = std::max<uint64_t>(Entry::min_num_buckets(), 3);
+    uint64_t target = num_bytes / sizeof(Bucket);
+
+    // Growing the table past the requested size could use far more memory than the machine has,
+    // so it is only done when asked for.
+    if (target < min_buckets) {
+        std::stringstream message;
+        message << "A " << BOARD_WIDTH << "x" << BOARD_HEIGHT << " board needs a table of at least "
+                << min_buckets * sizeof(Bucket) << " bytes, but only " << num_bytes << " bytes were requested.";
+
+        if (!std::getenv("C4_TABLE_GROW")) {
+            message << " Set C4_TABLE_SIZE to a larger size, or set C4_TABLE_GROW=1 to use the minimum size.";
+            std::cerr << message.str() << std::endl;
+
+            throw std::runtime_error(message.str());
+        }
+
+        std::cerr << message.str() << " Using the minimum size." << std::endl;
+        target = min_buckets;
+    }
+
+    // Find the largest prime which fits in the given memory, unless that would be below the minimum.
+    for (uint64_t n = target | 1; n >= min_buckets; n -= 2) {
+        if (is_prime(n)) {
+            return n;
+        }
+    }
+
+    for (uint64_t n = target | 1;; n += 2) {
+        if (is_prime(n)) {
+            return n;
+        }
+    }
+}
+
+template <class Policy>
+BasicTable<Policy>::BasicTable() : table_writer(std::make_shared<Writer>(get_table_filepath())) {
+    if (!LOAD_TABLE_SNAPSHOT || !load_snapshot()) {
+        allocate(get_table_size_setting(), get_table_dir_setting());
+    }
+}
+
+template <class Policy>
+BasicTable<Policy>::BasicTable(uint64_t num_bytes, const std::filesystem::path &directory)
+    : table_writer(std::make_shared<Writer>(get_table_filepath())) {
+    allocate(num_bytes, directory);
+}
+
+template <class Policy>
+void BasicTable<Policy>::allocate(uint64_t num_bytes, const std::filesystem::path &directory) {
+    num_buckets = choose_num_buckets(num_bytes);
+    bucket_index = FastMod(num_buckets);
+
+    assert(num_buckets % 2 == 1);
+    assert(num_buckets >= Entry::min_num_buckets());
+
+    if (!directory.empty()) {
+        Bucket *memory = static_cast<Bucket *>(allocate_file_pages(directory, num_buckets, sizeof(Bucket)));
+        if (memory) {
+            auto memory_free = [num_buckets = num_buckets](Bucket *memory) {
+                free_file_pages(memory, num_buckets, sizeof(Bucket));
+            };
+
+            // The file starts as all zeros, so all entries already start empty.
+            this->table = std::shared_ptr<Bucket[]>(memory, memory_free);
+            this->file_backed = true;
+            return;
+        }
+
+        std::cerr << "Failed to create a table file in " << directory << ". The table will be kept in memory."
+                  << std::endl;
+    }
+
+    Bucket *memory = static_cast<Bucket *>(allocate_huge_pages(num_buckets, sizeof(Bucket)));
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+
+    auto memory_free = [num_buckets = num_buckets](Bucket *memory) {
+        free_huge_pages(memory, num_buckets, sizeof(Bucket));
+    };
+
+    // Memory is zeroed by the OS, so all entries already start empty.
+    this->table = std::shared_ptr<Bucket[]>(memory, memory_free);
+}
+
+template <class Policy>
+void BasicTable<Policy>::clear(int part, int num_parts) {
+    assert(0 <= part && part < num_parts);
+
+    uint64_t begin = num_buckets * part / num_parts;
+    uint64_t end = num_buckets * (part + 1) / num_parts;
 
-    uint64_t index = static_cast<uint64_t>(hash % NUM_TABLE_ENTRIES);
-    os_prefetch(table.get() + index);
+    // Writing to every page of a file backed table would write the whole file to disk.
+    if (file_backed) {
+        clear_file_pages(table.get() + begin, (end - begin) * sizeof(Bucket));
+        return;
+    }
+
+    Bucket empty{};
+    std::fill(table.get() + begin, table.get() + end, empty);
+}
+
+template <class Policy>
+void BasicTable<Policy>::next_epoch() noexcept {
+    epoch->store((get_epoch() + 1) % Entry::num_epochs(), std::memory_order_relaxed);
 }
 
-Entry Table::get(board hash) const noexcept {
+template <class Policy>
+void BasicTable<Policy>::prefetch(board hash) const noexcept {
     assert(hash != 0);
 
-    uint64_t index = static_cast<uint64_t>(hash % NUM_TABLE_ENTRIES);
+    os_prefetch(&get_bucket(hash));
+}
+
+template <class Policy>
+Entry BasicTable<Policy>::get(board hash) const noexcept {
+    assert(hash != 0);
 
-    // Check if either of the two entries contain the position.
-    Entry entry_1 = table[index];
-    if (entry_1.is_equal(hash)) {
-        stats->lookup_success();
-        return entry_1;
+    // Check if any entry in the bucket contains the position.
+    Bucket &bucket = get_bucket(hash);
+    if constexpr (ENABLE_NUMA_STATS) {
+        sample_numa_node(bucket);
     }
 
-    Entry entry_2 = table[index + 1];
-    if (entry_2.is_equal(hash)) {
-        stats->lookup_success();
-        return entry_2;
+    for (Entry &slot : bucket.entries) {
+        // Other threads may write to the slot at any time, so only read it once.
+        Entry entry = slot;
+
+        if (entry.is_equal(hash)) {
+            stats->lookup_success();
+
+            // The entry is still useful, so move it to the current epoch to protect it from replacement.
+            // This writes to the bucket at most once per entry and epoch.
+            int current_epoch = get_epoch();
+            if (entry.get_epoch() != current_epoch) {
+                entry = entry.with_epoch(current_epoch);
+                slot = entry;
+            }
+
+            return entry;
+        }
     }
 
     // Otherwise we don't have the position in the table.
@@ -78,7 +341,8 @@ Entry Table::get(board hash) const noexcept {
     return Entry();
 }
 
-void Table::put(board hash, bool is_mirrored, int move, NodeType type, int score, unsigned long long num_nodes) noexcept {
+template <class Policy>
+void BasicTable<Policy>::put(board hash, bool is_mirrored, int move, NodeType type, int score, unsigned long long num_nodes) noexcept {
     assert(hash != 0);
     assert(0 <= move && move < BOARD_WIDTH);
     assert(type == NodeType::EXACT || type == NodeType::LOWER || type == NodeType::UPPER);
@@ -91,31 +355,17 @@ void Table::put(board hash, bool is_mirrored, int move, NodeType type, int score
     }
 
     // Store.
-    store(hash, Entry(hash, move, type, score, num_nodes));
+    store(hash, Entry(hash, move, type, score, num_nodes, get_epoch()));
 
     // Save significant results to the table file.
     if (UPDATE_TABLE_FILE && num_nodes > MIN_NODES_FOR_TABLE_FILE) {
-        std::string line;
-        if constexpr (IS_128_BIT_BOARD) {
-            line = std::to_string(static_cast<uint64_t>(hash >> 64)) + ","
-                + std::to_string(static_cast<uint64_t>(hash)) + ","
-                + std::to_string(move) + ","
-                + std::to_string(static_cast<int>(type)) + ","
-                + std::to_string(score) + ","
-                + std::to_string(num_nodes);
-        } else {
-            line = std::to_string(static_cast<uint64_t>(hash)) + ","
-                + std::to_string(move) + ","
-                + std::to_string(static_cast<int>(type)) + ","
-                + std::to_string(score) + ","
-                + std::to_string(num_nodes);
-        }
-
+        std::string line = format_table_line(hash, move, type, score, num_nodes);
         table_writer->add_line(line);
     }
 }
 
-void Table::load_table_file() {
+template <class Policy>
+void BasicTable<Policy>::load_table_file() {
     if constexpr (!LOAD_TABLE_FILE) {
         return;
     }
@@ -144,15 +394,7 @@ void Table::load_table_file() {
         std::getline(file, score_string, ',');
         std::getline(file, num_nodes_string);
 
-        board hash;
-        if constexpr (IS_128_BIT_BOARD) {
-            board hash1 = static_cast<board>(std::stoull(hash1_string));
-            board hash2 = static_cast<board>(std::stoull(hash2_string));
-
-            hash = (hash1 << 64) | hash2;
-        } else {
-            hash = std::stoull(hash1_string);
-        }
+        board hash = parse_table_hash(hash1_string, hash2_string);
 
         Entry entry(hash,
             std::stoi(move_string),
@@ -167,7 +409,8 @@ void Table::load_table_file() {
     std::cout << "Done. Read " << num_entries << " table entries." << std::endl << std::endl;
 }
 
-void Table::load_book_file() {
+template <class Policy>
+void BasicTable<Policy>::load_book_file() {
     if constexpr (!LOAD_BOOK_FILE) {
         return;
     }
@@ -201,13 +444,147 @@ void Table::load_book_file() {
     std::cout << "Done." << std::endl << std::endl;
 }
 
-void Table::store(board hash, Entry entry) noexcept {
-    // Overwrite the entry which required the least amount of work to compute.
-    uint64_t index = static_cast<uint64_t>(hash % NUM_TABLE_ENTRIES);
-    int offset = (table[index + 1].is_equal(hash) || table[index + 1].get_work() < table[index].get_work())
-        && !table[index].is_equal(hash);
+template <class Policy>
+bool BasicTable<Policy>::load_snapshot(const std::filesystem::path &path) {
+    assert(table.use_count() <= 1);
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open the table snapshot " << path << ". No snapshot will be loaded." << std::endl;
+        return false;
+    }
+
+    SnapshotHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    bool has_fixed_size = FIXED_TABLE_BUCKETS == 0 || header.num_buckets == FIXED_TABLE_BUCKETS;
+    if (!file || !is_snapshot_compatible(header) || !has_fixed_size) {
+        std::cerr << "The table snapshot " << path << " was saved by an incompatible build. No snapshot will be loaded."
+                  << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    uint64_t file_size = std::filesystem::file_size(path, error);
+    uint64_t snapshot_size = SNAPSHOT_HEADER_SIZE + header.num_buckets * sizeof(Bucket);
+    if (error || file_size != snapshot_size || header.num_buckets % 2 == 0
+            || header.num_buckets < Entry::min_num_buckets()) {
+        std::cerr << "The table snapshot " << path << " is corrupt. No snapshot will be loaded." << std::endl;
+        return false;
+    }
+
+    std::cout << "Loading table snapshot " << path << " . . ." << std::endl;
+
+    char *memory = static_cast<char *>(map_file(path, snapshot_size));
+    if (!memory) {
+        return false;
+    }
+
+    auto memory_unmap = [memory, snapshot_size](Bucket *) { unmap_file(memory, snapshot_size); };
+
+    // The mapping is copy on write, so the snapshot on disk is never changed by the search.
+    this->num_buckets = header.num_buckets;
+    this->bucket_index = FastMod(num_buckets);
+    this->table = std::shared_ptr<Bucket[]>(reinterpret_cast<Bucket *>(memory + SNAPSHOT_HEADER_SIZE), memory_unmap);
+    this->file_backed = false;
+    this->epoch->store(header.epoch % Entry::num_epochs(), std::memory_order_relaxed);
+
+    std::cout << "Done. Mapped a " << get_table_size() << " table." << std::endl << std::endl;
+
+    return true;
+}
+
+template <class Policy>
+bool BasicTable<Policy>::save_snapshot(const std::filesystem::path &path) const {
+    std::cout << "Saving table snapshot " << path << " . . ." << std::endl;
+
+    // Write to a temporary file which then replaces the snapshot, so a snapshot which is mapped by
+    // this or any other table is never changed in place, and a failed save leaves no partial file.
+    std::filesystem::path temp_path = path;
+    temp_path += ".tmp";
+
+    std::error_code error;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), error);
+    }
+
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+
+    std::vector<char> header_bytes(SNAPSHOT_HEADER_SIZE, 0);
+    SnapshotHeader header = make_snapshot_header(num_buckets, get_epoch());
+    std::memcpy(header_bytes.data(), &header, sizeof(header));
+
+    file.write(header_bytes.data(), header_bytes.size());
+    file.write(reinterpret_cast<const char *>(table.get()), num_buckets * sizeof(Bucket));
+    file.close();
+
+    if (!file) {
+        std::cerr << "Failed to write the table snapshot " << temp_path << "." << std::endl;
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::cerr << "Failed to replace the table snapshot " << path << ": " << error.message() << std::endl;
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    std::cout << "Done." << std::endl << std::endl;
+
+    return true;
+}
+
+template <class Policy>
+Bucket &BasicTable<Policy>::get_bucket(board hash) const noexcept {
+    // The compiler replaces a division by a constant 64 bit number with multiplications, which is
+    // faster than FastMod, but calls a library routine to divide 128 bit numbers.
+    if constexpr (FIXED_TABLE_BUCKETS != 0 && !IS_128_BIT_BOARD) {
+        // The number of buckets is odd, so the or only avoids a division by zero warning when not fixed.
+        return table[static_cast<uint64_t>(hash) % (FIXED_TABLE_BUCKETS | 1)];
+    } else {
+        return table[bucket_index.mod(hash)];
+    }
+}
 
-    Entry current = table[index + offset];
+template <class Policy>
+void BasicTable<Policy>::sample_numa_node(const Bucket &bucket) const noexcept {
+    // Finding the node of the bucket and of this thread takes two system calls, so only check a sample of lookups.
+    constexpr unsigned SAMPLE_INTERVAL = 4096;
+    if (++num_lookups % SAMPLE_INTERVAL != 0) {
+        return;
+    }
+
+    int memory_node = get_memory_numa_node(&bucket);
+    int current_node = get_current_numa_node();
+    if (memory_node >= 0 && current_node >= 0) {
+        stats->numa_lookup(memory_node == current_node);
+    }
+}
+
+template <class Policy>
+void BasicTable<Policy>::store(board hash, Entry entry) noexcept {
+    Bucket &bucket = get_bucket(hash);
+    int epoch = entry.get_epoch();
+
+    // Rewrite the entry if the position is already in the bucket. Otherwise take an empty
+    // entry, or overwrite the entry which the replacement policy values least.
+    Entry *slot = &bucket.entries[0];
+    int slot_value = Policy::get_keep_value(*slot, epoch);
+    for (Entry &candidate : bucket.entries) {
+        if (candidate.is_equal(hash)) {
+            slot = &candidate;
+            break;
+        }
+
+        int candidate_value = Policy::get_keep_value(candidate, epoch);
+        if (!slot->is_empty() && (candidate.is_empty() || candidate_value < slot_value)) {
+            slot = &candidate;
+            slot_value = candidate_value;
+        }
+    }
+
+    Entry current = *slot;
 
     // Update table statistics.
     if (current.is_empty()) {
@@ -219,28 +596,33 @@ void Table::store(board hash, Entry entry) noexcept {
         if (current.get_type() == NodeType::EXACT) {
             return;
         }
+
+        entry = entry.merge(current);
     } else {
         stats->store_overwrite();
     }
 
     // Store.
-    table[index + offset] = entry;
+    *slot = entry;
 }
 
-std::string Table::get_table_size() {
+template <class Policy>
+std::string BasicTable<Policy>::get_table_size() const {
     std::stringstream result;
     result << std::fixed << std::setprecision(2);
 
-    uint64_t bytes = NUM_TABLE_ENTRIES * sizeof(Entry);
+    uint64_t bytes = num_buckets * sizeof(Bucket);
     double kb = bytes / 1024.0;
     double mb = kb / 1024.0;
     double gb = mb / 1024.0;
 
-    if (kb < 1) {
+    // Tables sized to a prime number of buckets are slightly smaller than a round number,
+    // so switch units once the rounded value would reach 1024.
+    if (kb < 0.995) {
         result << bytes << " B";
-    } else if (mb < 1) {
+    } else if (mb < 0.995) {
         result << kb << " KB";
-    } else if (gb < 1) {
+    } else if (gb < 0.995) {
         result << mb << " MB";
     } else {
         result << gb << " GB";
@@ -248,3 +630,8 @@ std::string Table::get_table_size() {
 
     return result.str();
 }
+
+template class BasicTable<WorkPreferred>;
+template class BasicTable<AlwaysReplace>;
+template class BasicTable<ExactPreferred>;
+template class BasicTable<AgedWorkPreferred>;
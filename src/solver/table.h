@@ -1,21 +1,55 @@
 #ifndef TABLE_H_
 #define TABLE_H_
 
+#include <atomic>
+#include <filesystem>
 #include <memory>
 #include <string>
 
 #include "entry.h"
+#include "replacement.h"
 #include "types.h"
+#include "util/fastmod.h"
+#include "util/os.h"
 #include "util/stats.h"
 #include "util/writer.h"
 
-class Table {
+// Entries are grouped into buckets the size of a cache line, so any lookup
+// will only ever touch a single cache line.
+inline constexpr int CACHE_LINE_SIZE = 64;
+inline constexpr int ENTRIES_PER_BUCKET = CACHE_LINE_SIZE / sizeof(Entry);
+
+struct alignas(CACHE_LINE_SIZE) Bucket {
+    Entry entries[ENTRIES_PER_BUCKET];
+};
+
+static_assert(sizeof(Bucket) == CACHE_LINE_SIZE);
+
+// The replacement policy decides which entry of a full bucket is overwritten, see replacement.h.
+template <class Policy>
+class BasicTable {
    public:
-    Table();
-    Table(const Table &parent, std::shared_ptr<Stats> stats)
-        : table(parent.table), stats(std::move(stats)), table_writer(parent.table_writer) {}
+    // Create a table using the size from the C4_TABLE_SIZE environment variable, or
+    // DEFAULT_TABLE_SIZE if not set, and stored in the directory from C4_TABLE_DIR or
+    // DEFAULT_TABLE_DIR. If LOAD_TABLE_SNAPSHOT is set, the table is instead restored from
+    // the snapshot file when one exists.
+    BasicTable();
 
-    void clear();
+    // Create a table of the given size, backed by a file in the directory if one is given.
+    explicit BasicTable(uint64_t num_bytes, const std::filesystem::path &directory = "");
+    BasicTable(const BasicTable &parent, std::shared_ptr<Stats> stats)
+        : num_buckets(parent.num_buckets), bucket_index(parent.bucket_index), table(parent.table),
+          file_backed(parent.file_backed), epoch(parent.epoch), stats(std::move(stats)),
+          table_writer(parent.table_writer) {}
+
+    // Set all entries in one part of the table to empty. Calling this for every part
+    // will clear the whole table, so the work can be split across threads.
+    void clear(int part = 0, int num_parts = 1);
+
+    // Start a new epoch. Entries which are not used again in later epochs are aged, and are
+    // replaced before entries from the current search, so the table stays useful across many
+    // solves without being cleared.
+    void next_epoch() noexcept;
 
     void prefetch(board hash) const noexcept;
     Entry get(board hash) const noexcept;
@@ -24,19 +58,48 @@ class Table {
     void load_table_file();
     void load_book_file();
 
-    static std::string get_table_size();
+    // Snapshots are binary copies of the whole table. Loading a snapshot maps the file into memory, so
+    // entries are only read from disk as they are used, and the table takes the size of the snapshot.
+    // A snapshot can only be loaded before any copies of the table are made.
+    bool load_snapshot(const std::filesystem::path &path = get_snapshot_filepath());
+    bool save_snapshot(const std::filesystem::path &path = get_snapshot_filepath()) const;
+
+    static std::filesystem::path get_snapshot_filepath();
+
+    uint64_t get_num_buckets() const noexcept { return num_buckets; }
+    bool is_file_backed() const noexcept { return file_backed; }
+    std::string get_table_size() const;
+    PageUsage get_page_usage() const { return ::get_page_usage(table.get(), num_buckets * sizeof(Bucket)); }
 
    private:
+    uint64_t num_buckets{0};
+    FastMod bucket_index{1};
+
     // The table is shared across all threads.
-    std::shared_ptr<Entry[]> table;
+    std::shared_ptr<Bucket[]> table;
+    bool file_backed{false};
+
+    // The current epoch is shared across all threads.
+    std::shared_ptr<std::atomic<int>> epoch{std::make_shared<std::atomic<int>>(0)};
 
     // Stats are only shared with other objects on the same thread.
-    std::shared_ptr<Stats> stats;
+    std::shared_ptr<Stats> stats{std::make_shared<Stats>()};
 
     // The writer is shared across all threads and is used to save significant results.
     std::shared_ptr<Writer> table_writer;
 
+    // Counts lookups on this thread, so a sample can be checked for NUMA stats.
+    mutable unsigned num_lookups{0};
+
+    void allocate(uint64_t num_bytes, const std::filesystem::path &directory);
+
+    int get_epoch() const noexcept { return epoch->load(std::memory_order_relaxed); }
+
+    Bucket &get_bucket(board hash) const noexcept;
+    void sample_numa_node(const Bucket &bucket) const noexcept;
     void store(board hash, Entry entry) noexcept;
 };
 
+using Table = BasicTable<DefaultReplacementPolicy>;
+
 #endif
@@ -0,0 +1,81 @@
+#ifndef FASTMOD_H_
+#define FASTMOD_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "../types.h"
+
+// Computes n % divisor for a divisor fixed at construction, replacing the division with
+// multiplications by a precomputed reciprocal. See Lemire, Kaser & Kurz, "Faster Remainder
+// by Direct Computation" (2019).
+//
+// The result is always exactly n % divisor, so the table index stays a true remainder of
+// the hash and the Chinese Remainder Theorem still applies to the partial hash in each entry.
+class FastMod {
+   public:
+#ifdef __SIZEOF_INT128__
+    explicit FastMod(uint64_t divisor)
+        : divisor(divisor), reciprocal(~static_cast<__uint128_t>(0) / divisor + 1) {
+        // Precompute (high * 2^64) % divisor for each small high word.
+        auto mods = std::make_shared<HighWordMods>();
+        for (size_t high = 0; high < mods->size(); high++) {
+            (*mods)[high] = static_cast<uint64_t>((static_cast<__uint128_t>(high) << 64) % divisor);
+        }
+
+        high_word_mods = std::move(mods);
+    }
+
+    inline uint64_t mod(uint64_t n) const noexcept {
+        __uint128_t low_bits = reciprocal * n;
+
+        // Return the high 64 bits of the 192 bit product low_bits * divisor.
+        __uint128_t bottom_half = ((low_bits & UINT64_MAX) * divisor) >> 64;
+        __uint128_t top_half = (low_bits >> 64) * divisor;
+
+        return static_cast<uint64_t>((bottom_half + top_half) >> 64);
+    }
+
+    inline uint64_t mod(__uint128_t n) const noexcept {
+        uint64_t high = static_cast<uint64_t>(n >> 64);
+        uint64_t low = mod(static_cast<uint64_t>(n));
+
+        // Hashes of boards wider than 64 bits only use a few bits above the low 64 bits, so
+        // the high word can be reduced with a lookup.
+        if (high < high_word_mods->size()) {
+            // Both terms are below the divisor, but their sum can overflow 64 bits for divisors above 2^63.
+            __uint128_t result = static_cast<__uint128_t>((*high_word_mods)[high]) + low;
+
+            return static_cast<uint64_t>((result >= divisor) ? result - divisor : result);
+        }
+
+        // Otherwise fold the high word onto the low word using 2^64 = high_word_mods[1].
+        return mod(static_cast<__uint128_t>(mod(high)) * (*high_word_mods)[1] + low);
+    }
+#else
+    explicit FastMod(uint64_t divisor) noexcept : divisor(divisor) {}
+
+    // Without 128 bit integers the reciprocal cannot be applied, so fall back to a division.
+    inline uint64_t mod(uint64_t n) const noexcept { return n % divisor; }
+#endif
+
+    inline uint64_t get_divisor() const noexcept { return divisor; }
+
+   private:
+    uint64_t divisor;
+
+#ifdef __SIZEOF_INT128__
+    // ceil(2^128 / divisor), wrapping to 0 when the divisor is 1.
+    __uint128_t reciprocal;
+
+    // Enough entries to cover every bit above the low 64 bits on boards up to 8x8. The lookup is
+    // up to 2 KB, so it is shared by all copies instead of being copied into every table handle.
+    static constexpr int HIGH_WORD_BITS = std::clamp((BOARD_HEIGHT + 1) * BOARD_WIDTH - 64, 1, 8);
+    using HighWordMods = std::array<uint64_t, 1 << HIGH_WORD_BITS>;
+    std::shared_ptr<const HighWordMods> high_word_mods;
+#endif
+};
+
+#endif
@@ -1,19 +1,64 @@
 #include "os.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 #if defined(_WIN32)
+// Stop windows.h from defining min and max macros, which break std::min and std::max.
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
-#elif defined(__linux__)
+#else
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
 #endif
 
 #include "../settings.h"
 
+static constexpr size_t LARGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Allocations are rounded up to a whole number of large pages, so the size is the same whether
+// or not huge pages could be used.
+static size_t get_allocate_size(size_t count, size_t size) {
+    return (count * size + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1);
+}
+
+// Memory is taken directly from the OS, which maps every page to a zero page until the page is
+// first written. A new table is therefore already empty, and no page is touched before it is used.
+static void *allocate_pages(size_t allocate_size) {
+#if defined(_WIN32)
+    return VirtualAlloc(NULL, allocate_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void *memory = mmap(nullptr, allocate_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    return (memory == MAP_FAILED) ? nullptr : memory;
+#endif
+}
+
 #if defined(_WIN32)
 #define WINDOWS_HUGE_PAGES
 
-static void *windows_allocate_huge_pages(size_t count, size_t size) {
+static void *windows_allocate_huge_pages(size_t allocate_size) {
     size_t large_page_size = GetLargePageMinimum();
     if (!large_page_size) {
         std::cerr << "Error fetching large page size." << std::endl;
@@ -51,7 +96,7 @@ static void *windows_allocate_huge_pages(size_t count, size_t size) {
     }
 
     // Round up to the nearest large page size.
-    size_t allocate_size = (count * size + large_page_size - 1) & ~(large_page_size - 1);
+    allocate_size = (allocate_size + large_page_size - 1) & ~(large_page_size - 1);
 
     void *mem_with_huge_pages = VirtualAlloc(
             NULL, allocate_size, MEM_LARGE_PAGES | MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
@@ -65,72 +110,632 @@ static void *windows_allocate_huge_pages(size_t count, size_t size) {
 #elif defined(MADV_HUGEPAGE)
 #define UNIX_HUGE_PAGES
 
-static void *unix_allocate_huge_pages(size_t count, size_t size) {
-    constexpr size_t large_page_size = 2 * 1024 * 1024;
+static void *unix_allocate_huge_pages(size_t allocate_size) {
+    // Allocate an extra large page, then trim the mapping so it starts on a large page boundary.
+    char *memory = static_cast<char *>(allocate_pages(allocate_size + LARGE_PAGE_SIZE));
+    if (!memory) {
+        return nullptr;
+    }
 
-    // Round up to the nearest large page size.
-    size_t allocate_size = (count * size + large_page_size - 1) & ~(large_page_size - 1);
+    uintptr_t address = reinterpret_cast<uintptr_t>(memory);
+    char *aligned = memory + (((address + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1)) - address);
+
+    size_t head_size = aligned - memory;
+    size_t tail_size = LARGE_PAGE_SIZE - head_size;
+    if (head_size) {
+        munmap(memory, head_size);
+    }
+    if (tail_size) {
+        munmap(aligned + allocate_size, tail_size);
+    }
+
+    madvise(aligned, allocate_size, MADV_HUGEPAGE);
+
+    return aligned;
+}
+#endif
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+#define LINUX_HUGETLB_PAGES
+
+// Values from <linux/mman.h>, which older C libraries do not define.
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
 
-    void *memory = std::aligned_alloc(large_page_size, allocate_size);
-    madvise(memory, allocate_size, MADV_HUGEPAGE);
+static constexpr size_t GIANT_PAGE_SIZE = 1024 * 1024 * 1024;
+
+// Huge page mappings can only be unmapped in whole pages, which may be larger than the size
+// from get_allocate_size, so the size of each mapping is saved here.
+static std::mutex hugetlb_mutex;
+static std::unordered_map<void *, size_t> hugetlb_sizes;
+
+// Maps pages from the kernel's pool of reserved huge pages. Unlike transparent huge pages,
+// the mapping fails instead of silently using small pages when not enough pages are reserved.
+static void *linux_allocate_hugetlb_pages(size_t allocate_size, size_t page_size, int page_flag) {
+    size_t map_size = (allocate_size + page_size - 1) & ~(page_size - 1);
+
+    void *memory = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | page_flag, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(hugetlb_mutex);
+    hugetlb_sizes[memory] = map_size;
 
     return memory;
 }
+
+// Returns true if the memory was allocated by linux_allocate_hugetlb_pages, and unmaps it.
+static bool linux_free_hugetlb_pages(void *memory) {
+    std::lock_guard<std::mutex> lock(hugetlb_mutex);
+
+    auto mapping = hugetlb_sizes.find(memory);
+    if (mapping == hugetlb_sizes.end()) {
+        return false;
+    }
+
+    if (munmap(memory, mapping->second)) {
+        std::cerr << "Error freeing memory." << std::endl;
+    }
+
+    hugetlb_sizes.erase(mapping);
+    return true;
+}
+#endif
+
+// Reads a list of ids from sysfs, given as ranges such as "0-3,6".
+static std::vector<int> read_id_list(const std::string &path) {
+    std::vector<int> ids;
+
+    std::ifstream file(path);
+    std::string range;
+    while (std::getline(file, range, ',')) {
+        int first, last;
+        char dash;
+        std::istringstream range_stream(range);
+        if (!(range_stream >> first)) {
+            break;
+        }
+        if (!(range_stream >> dash >> last)) {
+            last = first;
+        }
+
+        for (int id = first; id <= last; id++) {
+            ids.push_back(id);
+        }
+    }
+
+    return ids;
+}
+
+// Returns the NUMA nodes which have memory. Nodes are read from sysfs, so libnuma is not needed.
+static std::vector<int> get_numa_nodes() {
+#if defined(__linux__)
+    std::vector<int> nodes = read_id_list("/sys/devices/system/node/has_memory");
+    if (nodes.empty()) {
+        nodes = read_id_list("/sys/devices/system/node/online");
+    }
+
+    return nodes;
+#else
+    return {};
+#endif
+}
+
+// Sets the memory policy of the pages so they are spread across all NUMA nodes as they are first used.
+static void interleave_pages(void *memory, size_t size) {
+    if (!ENABLE_NUMA_INTERLEAVE) {
+        return;
+    }
+
+#if defined(__linux__) && defined(SYS_mbind)
+    std::vector<int> nodes = get_numa_nodes();
+    if (nodes.size() < 2) {
+        return;
+    }
+
+    constexpr int BITS_PER_WORD = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> node_mask(*std::max_element(nodes.begin(), nodes.end()) / BITS_PER_WORD + 1);
+    for (int node : nodes) {
+        node_mask[node / BITS_PER_WORD] |= 1ul << (node % BITS_PER_WORD);
+    }
+
+    // Same value as MPOL_INTERLEAVE in <numaif.h>. The kernel reads one less bit than maxnode.
+    constexpr int MPOL_INTERLEAVE_MODE = 3;
+    unsigned long max_node = node_mask.size() * BITS_PER_WORD + 1;
+    if (syscall(SYS_mbind, memory, size, MPOL_INTERLEAVE_MODE, node_mask.data(), max_node, 0)) {
+        std::cerr << "Error interleaving memory across NUMA nodes: " << std::strerror(errno) << std::endl;
+    }
+#else
+    (void)memory;
+    (void)size;
 #endif
+}
 
 void *allocate_huge_pages(size_t count, size_t size) {
+    size_t allocate_size = get_allocate_size(count, size);
+
     if (!ENABLE_HUGE_PAGES) {
-        return calloc(count, size);
+        void *memory = allocate_pages(allocate_size);
+        if (memory) {
+            interleave_pages(memory, allocate_size);
+        }
+
+        return memory;
     }
 
 #if defined(WINDOWS_HUGE_PAGES)
-    void *mem_with_huge_pages = windows_allocate_huge_pages(count, size);
+    void *mem_with_huge_pages = windows_allocate_huge_pages(allocate_size);
 #elif defined(UNIX_HUGE_PAGES)
-    void *mem_with_huge_pages = unix_allocate_huge_pages(count, size);
+    // Try reserved 1 GB pages, then reserved 2 MB pages, then transparent huge pages. 1 GB pages
+    // are only used when rounding up to a whole page wastes at most an eighth of the memory.
+    void *mem_with_huge_pages = nullptr;
+
+#if defined(LINUX_HUGETLB_PAGES)
+    size_t giant_page_waste = ((allocate_size + GIANT_PAGE_SIZE - 1) & ~(GIANT_PAGE_SIZE - 1)) - allocate_size;
+    if (giant_page_waste <= allocate_size / 8) {
+        mem_with_huge_pages = linux_allocate_hugetlb_pages(allocate_size, GIANT_PAGE_SIZE, MAP_HUGE_1GB);
+    }
+    if (!mem_with_huge_pages) {
+        mem_with_huge_pages = linux_allocate_hugetlb_pages(allocate_size, LARGE_PAGE_SIZE, MAP_HUGE_2MB);
+    }
+#endif
+
+    if (!mem_with_huge_pages) {
+        mem_with_huge_pages = unix_allocate_huge_pages(allocate_size);
+    }
 #else
     std::cerr << "Error huge pages requested but not implemented." << std::endl;
     void *mem_with_huge_pages = nullptr;
 #endif
 
     if (!mem_with_huge_pages) {
-        return calloc(count, size);
+        mem_with_huge_pages = allocate_pages(allocate_size);
+    }
+
+    if (mem_with_huge_pages) {
+        interleave_pages(mem_with_huge_pages, allocate_size);
     }
 
     return mem_with_huge_pages;
 }
 
-void free_huge_pages(void *memory) {
+void free_huge_pages(void *memory, size_t count, size_t size) {
     if (!memory) {
         std::cerr << "Error memory already freed." << std::endl;
         return;
     }
 
-    if (!ENABLE_HUGE_PAGES) {
-        free(memory);
+#ifdef _WIN32
+    if (!VirtualFree(memory, 0, MEM_RELEASE)) {
+        std::cerr << "Error freeing memory." << std::endl;
+    }
+#else
+#if defined(LINUX_HUGETLB_PAGES)
+    if (linux_free_hugetlb_pages(memory)) {
         return;
     }
+#endif
+
+    if (munmap(memory, get_allocate_size(count, size))) {
+        std::cerr << "Error freeing memory." << std::endl;
+    }
+#endif
+}
 
-#ifdef _WIN32
-    if (!VirtualFree(memory, 0, MEM_RELEASE)) {
+void *allocate_file_pages(const std::filesystem::path &directory, size_t count, size_t size) {
+    size_t allocate_size = get_allocate_size(count, size);
+
+#if defined(_WIN32)
+    wchar_t name[MAX_PATH];
+    if (!GetTempFileNameW(directory.c_str(), L"c4", 0, name)) {
+        std::cerr << "Error creating a table file in " << directory << "." << std::endl;
+        return nullptr;
+    }
+
+    HANDLE file = CreateFileW(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error creating a table file in " << directory << "." << std::endl;
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READWRITE, static_cast<DWORD>(allocate_size >> 32),
+        static_cast<DWORD>(allocate_size), NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        std::cerr << "Error mapping the table file." << std::endl;
+        return nullptr;
+    }
+
+    // The view keeps the file open, and the file is deleted once the view is unmapped.
+    void *memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, allocate_size);
+    CloseHandle(mapping);
+    if (!memory) {
+        std::cerr << "Error mapping the table file." << std::endl;
+    }
+
+    return memory;
+#else
+    std::string name = (directory / "c4-table-XXXXXX").string();
+    int file = mkstemp(name.data());
+    if (file == -1) {
+        std::cerr << "Error creating a table file in " << directory << ": " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    // The file is only used through the mapping, so remove its name straight away. The disk
+    // space is released when the memory is unmapped, even if the solver exits early.
+    unlink(name.c_str());
+
+    // Extending the file leaves a sparse file of zeros, so no disk space is used until a page is written.
+    if (ftruncate(file, allocate_size)) {
+        std::cerr << "Error resizing the table file: " << std::strerror(errno) << std::endl;
+        close(file);
+        return nullptr;
+    }
+
+    // Reserve an extra large page of address space, then map the file over a large page boundary,
+    // so huge pages can be used where the file system supports them.
+    char *reserved = static_cast<char *>(
+        mmap(nullptr, allocate_size + LARGE_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+    if (reserved == MAP_FAILED) {
+        close(file);
+        return nullptr;
+    }
+
+    uintptr_t address = reinterpret_cast<uintptr_t>(reserved);
+    char *aligned = reserved + (((address + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1)) - address);
+
+    void *memory = mmap(aligned, allocate_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file, 0);
+    close(file);
+
+    size_t head_size = aligned - reserved;
+    size_t tail_size = LARGE_PAGE_SIZE - head_size;
+    if (head_size) {
+        munmap(reserved, head_size);
+    }
+    if (tail_size) {
+        munmap(aligned + allocate_size, tail_size);
+    }
+
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error mapping the table file: " << std::strerror(errno) << std::endl;
+        munmap(aligned, allocate_size);
+        return nullptr;
+    }
+
+    // Table lookups are random, so reading ahead would only evict useful pages from memory.
+    madvise(memory, allocate_size, MADV_RANDOM);
+
+#if defined(MADV_HUGEPAGE)
+    if (ENABLE_HUGE_PAGES) {
+        madvise(memory, allocate_size, MADV_HUGEPAGE);
+    }
+#endif
+
+    return memory;
+#endif
+}
+
+void free_file_pages(void *memory, size_t count, size_t size) {
+#if defined(_WIN32)
+    if (!UnmapViewOfFile(memory)) {
         std::cerr << "Error freeing memory." << std::endl;
     }
 #else
-    free(memory);
+    if (munmap(memory, get_allocate_size(count, size))) {
+        std::cerr << "Error freeing memory." << std::endl;
+    }
 #endif
 }
 
-void set_thread_affinity(std::thread &thread, int id) {
-    if (!ENABLE_AFFINITY) {
+void clear_file_pages(void *memory, size_t size) {
+    char *begin = static_cast<char *>(memory);
+    char *end = begin + size;
+
+#if defined(MADV_REMOVE)
+    // Writing zeros to every page would write the whole file to disk, so instead punch a hole in the
+    // file for each whole page, and only write zeros to the partial pages at either end.
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGE_SIZE));
+    char *page_begin = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(begin) + page_size - 1) & ~(page_size - 1));
+    char *page_end = reinterpret_cast<char *>(reinterpret_cast<uintptr_t>(end) & ~(page_size - 1));
+
+    if (page_begin < page_end && !madvise(page_begin, page_end - page_begin, MADV_REMOVE)) {
+        std::fill(begin, page_begin, 0);
+        std::fill(page_end, end, 0);
         return;
     }
+#endif
 
-#ifdef _WIN32
-    SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << id);
+    std::fill(begin, end, 0);
+}
+
+PageFaults get_page_faults() {
+    PageFaults faults{};
+
+#if !defined(_WIN32)
+    rusage usage{};
+    if (!getrusage(RUSAGE_SELF, &usage)) {
+        faults.minor = usage.ru_minflt;
+        faults.major = usage.ru_majflt;
+    }
+#endif
+
+    return faults;
+}
+
+void *map_file(const std::filesystem::path &path, size_t size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error opening " << path << " for mapping." << std::endl;
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        std::cerr << "Error mapping " << path << "." << std::endl;
+        return nullptr;
+    }
+
+    // The view keeps the mapping open after the handle is closed.
+    void *memory = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, size);
+    CloseHandle(mapping);
+    if (!memory) {
+        std::cerr << "Error mapping " << path << "." << std::endl;
+    }
+
+    return memory;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file == -1) {
+        std::cerr << "Error opening " << path << " for mapping." << std::endl;
+        return nullptr;
+    }
+
+    // The mapping keeps the file open after the descriptor is closed.
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error mapping " << path << "." << std::endl;
+        return nullptr;
+    }
+
+    return memory;
+#endif
+}
+
+void unmap_file(void *memory, size_t size) {
+#if defined(_WIN32)
+    if (!UnmapViewOfFile(memory)) {
+        std::cerr << "Error unmapping file." << std::endl;
+    }
+#else
+    if (munmap(memory, size)) {
+        std::cerr << "Error unmapping file." << std::endl;
+    }
+#endif
+}
+
+PageUsage get_page_usage(const void *memory, size_t size) {
+    PageUsage usage{};
+
+#if defined(__linux__)
+    uintptr_t begin = reinterpret_cast<uintptr_t>(memory);
+    uintptr_t end = begin + size;
+
+    // Each mapping starts with a line giving its address range, followed by one line for each field.
+    std::ifstream file("/proc/self/smaps");
+    std::string line;
+    bool in_range = false;
+    while (std::getline(file, line)) {
+        uintptr_t map_begin, map_end;
+        char dash;
+        std::istringstream line_stream(line);
+        if (line_stream >> std::hex >> map_begin >> dash >> map_end && dash == '-') {
+            in_range = map_begin < end && begin < map_end;
+            continue;
+        }
+
+        if (!in_range) {
+            continue;
+        }
+
+        std::string field;
+        uint64_t kb;
+        line_stream.clear();
+        line_stream.seekg(0);
+        if (!(line_stream >> field >> std::dec >> kb)) {
+            continue;
+        }
+
+        // Reserved huge pages are counted separately from the resident set.
+        if (field == "Rss:") {
+            usage.resident_bytes += kb * 1024;
+        } else if (field == "AnonHugePages:") {
+            usage.huge_page_bytes += kb * 1024;
+        } else if (field == "Private_Hugetlb:" || field == "Shared_Hugetlb:") {
+            usage.resident_bytes += kb * 1024;
+            usage.huge_page_bytes += kb * 1024;
+        } else if (field == "KernelPageSize:") {
+            usage.page_size = std::max<uint64_t>(usage.page_size, kb * 1024);
+        }
+    }
+#else
+    (void)memory;
+    (void)size;
+#endif
+
+    return usage;
+}
+
+int get_num_numa_nodes() {
+    return std::max<int>(get_numa_nodes().size(), 1);
+}
+
+int get_memory_numa_node(const void *address) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+    // Same values as MPOL_F_NODE and MPOL_F_ADDR in <numaif.h>.
+    constexpr unsigned long MPOL_F_NODE_FLAG = 1;
+    constexpr unsigned long MPOL_F_ADDR_FLAG = 2;
+
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, address, MPOL_F_NODE_FLAG | MPOL_F_ADDR_FLAG)) {
+        return -1;
+    }
+
+    return node;
+#else
+    (void)address;
+    return -1;
+#endif
+}
+
+int get_current_numa_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+        return -1;
+    }
+
+    return static_cast<int>(node);
+#else
+    return -1;
+#endif
+}
+
+#if defined(__linux__)
+// Returns the first number in a sysfs file, or -1 if it cannot be read.
+static int read_sysfs_int(const std::string &path) {
+    std::ifstream file(path);
+    int value;
+
+    return (file >> value) ? value : -1;
+}
+#endif
+
+std::vector<int> get_cpu_placement(bool spread_sockets) {
+    std::vector<int> cpus;
+
+#if defined(__linux__)
+    struct Cpu {
+        int id;
+        int socket;
+        int core;
+        int core_rank{0};
+        int sibling_rank{0};
+    };
+
+    // Only place threads on CPUs this process is allowed to run on.
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool has_allowed = !sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    std::vector<Cpu> topology;
+    for (int id : read_id_list("/sys/devices/system/cpu/online")) {
+        if (has_allowed && id < CPU_SETSIZE && !CPU_ISSET(id, &allowed)) {
+            continue;
+        }
+
+        std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/";
+        topology.push_back({id, read_sysfs_int(path + "physical_package_id"), read_sysfs_int(path + "core_id")});
+    }
+
+    // Rank each core within its socket, and each SMT sibling within its core.
+    for (Cpu &cpu : topology) {
+        std::vector<int> socket_cores;
+        for (const Cpu &other : topology) {
+            if (other.socket == cpu.socket) {
+                socket_cores.push_back(other.core);
+            }
+            if (other.socket == cpu.socket && other.core == cpu.core && other.id < cpu.id) {
+                cpu.sibling_rank++;
+            }
+        }
+
+        std::sort(socket_cores.begin(), socket_cores.end());
+        socket_cores.erase(std::unique(socket_cores.begin(), socket_cores.end()), socket_cores.end());
+        cpu.core_rank = std::lower_bound(socket_cores.begin(), socket_cores.end(), cpu.core) - socket_cores.begin();
+    }
+
+    // Use every physical core before any SMT siblings. Then either fill each socket in turn so
+    // threads share a last level cache, or alternate between sockets to use all memory bandwidth.
+    std::sort(topology.begin(), topology.end(), [spread_sockets](const Cpu &a, const Cpu &b) {
+        if (spread_sockets) {
+            return std::tie(a.sibling_rank, a.core_rank, a.socket, a.id) < std::tie(b.sibling_rank, b.core_rank, b.socket, b.id);
+        }
+
+        return std::tie(a.sibling_rank, a.socket, a.core_rank, a.id) < std::tie(b.sibling_rank, b.socket, b.core_rank, b.id);
+    });
+
+    for (const Cpu &cpu : topology) {
+        cpus.push_back(cpu.id);
+    }
 #else
+    (void)spread_sockets;
+#endif
+
+    // Without topology, place threads on CPUs in order.
+    if (cpus.empty()) {
+        for (unsigned id = 0; id < std::max<unsigned>(std::thread::hardware_concurrency(), 1); id++) {
+            cpus.push_back(id);
+        }
+    }
+
+    return cpus;
+}
+
+void set_thread_affinity(std::thread &thread, int cpu) {
+#if defined(_WIN32)
+    if (!SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu)) {
+        std::cerr << "Error setting thread affinity." << std::endl;
+    }
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    int error = pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+    if (error) {
+        std::cerr << "Error setting thread affinity: " << std::strerror(error) << std::endl;
+    }
+#else
+    (void)thread;
+    (void)cpu;
     std::cerr << "Error thread affinity requested but not implemented." << std::endl;
 #endif
 }
 
+uint64_t get_physical_memory() {
+#if defined(_WIN32)
+    MEMORYSTATUSEX status{};
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status)) {
+        return 0;
+    }
+
+    return status.ullTotalPhys;
+#else
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || page_size <= 0) {
+        return 0;
+    }
+
+    return static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size);
+#endif
+}
+
 void os_prefetch(void *address) {
 #ifdef _WIN32
     _mm_prefetch(static_cast<const char *>(address), _MM_HINT_T2);
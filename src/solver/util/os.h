@@ -2,15 +2,81 @@
 #define OS_H_
 
 #include <cstdint>
+#include <filesystem>
 #include <thread>
+#include <vector>
 
 // This file defines any OS specific utilities used by the search.
 
+// Returned memory is zeroed and aligned to at least a page. Pages are only
+// backed by physical memory once they are first written. If ENABLE_NUMA_INTERLEAVE
+// is set, pages are spread across all NUMA nodes.
+//
+// If ENABLE_HUGE_PAGES is set, reserved 1 GB or 2 MB pages are used on Linux when the kernel
+// has enough reserved, then transparent huge pages, and otherwise normal pages.
 void *allocate_huge_pages(size_t count, size_t size);
 
-void free_huge_pages(void *memory);
+void free_huge_pages(void *memory, size_t count, size_t size);
 
-void set_thread_affinity(std::thread &thread, int id);
+// Returned memory is zeroed and backed by a new temporary file in the given directory, instead of
+// by physical memory and swap, so the allocation can be larger than physical memory. The file is
+// removed once the memory is freed. Returns null if the file could not be created.
+void *allocate_file_pages(const std::filesystem::path &directory, size_t count, size_t size);
+
+void free_file_pages(void *memory, size_t count, size_t size);
+
+// Sets the memory to zero and releases the disk space used by any whole pages in the range.
+// The memory must have come from allocate_file_pages.
+void clear_file_pages(void *memory, size_t size);
+
+// Page faults taken by this process since it started. A major fault had to read from disk.
+// Not implemented on Windows, where both counts are always zero.
+struct PageFaults {
+    uint64_t minor{0};
+    uint64_t major{0};
+};
+
+PageFaults get_page_faults();
+
+// Maps the first size bytes of a file into memory. The mapping is copy on write, so pages are only
+// read from disk when first used, and writes to the memory never change the file.
+// Returns null if the file could not be mapped.
+void *map_file(const std::filesystem::path &path, size_t size);
+
+void unmap_file(void *memory, size_t size);
+
+// Describes the pages backing a range of memory. Only implemented on Linux, where it is read
+// from /proc/self/smaps, and is otherwise all zeros.
+struct PageUsage {
+    // Bytes which have been touched, and how many of those are on huge pages.
+    uint64_t resident_bytes{0};
+    uint64_t huge_page_bytes{0};
+
+    // Page size used by the kernel, which is only larger than the base page size for reserved huge pages.
+    uint64_t page_size{0};
+};
+
+PageUsage get_page_usage(const void *memory, size_t size);
+
+// Returns the number of NUMA nodes with memory, or 1 if unknown.
+int get_num_numa_nodes();
+
+// Returns the NUMA node of the memory at the address, or of the core running this thread.
+// Returns -1 if unknown.
+int get_memory_numa_node(const void *address);
+int get_current_numa_node();
+
+// Returns the CPUs in the order search threads should be placed on them. Every physical core is
+// used before any SMT siblings, and each socket is filled in turn unless spread_sockets is set,
+// in which case threads alternate between sockets. Topology is only read on Linux, and otherwise
+// CPUs are returned in order.
+std::vector<int> get_cpu_placement(bool spread_sockets);
+
+// Restrict the thread to run only on the given CPU. Only implemented on Windows and Linux.
+void set_thread_affinity(std::thread &thread, int cpu);
+
+// Returns the total physical memory of the machine in bytes, or 0 if unknown.
+uint64_t get_physical_memory();
 
 void os_prefetch(void *address);
 
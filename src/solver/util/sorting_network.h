@@ -0,0 +1,115 @@
+#ifndef SORTING_NETWORK_H_
+#define SORTING_NETWORK_H_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// A compare and swap between two keys, which leaves the higher key at the lower index.
+struct Comparator {
+    int high;
+    int low;
+};
+
+// Calls visit on each comparator of Batcher's odd-even merge sort for n keys, in order. Every
+// comparator which would touch a key past n is skipped, which is the same as padding the keys
+// with the lowest possible key up to the next power of two.
+template <class Visitor>
+constexpr void generate_odd_even_merge_sort(int n, Visitor visit) noexcept {
+    for (int p = 1; p < n; p *= 2) {
+        for (int k = p; k >= 1; k /= 2) {
+            for (int j = k % p; j + k < n; j += 2 * k) {
+                for (int i = 0; i < std::min(k, n - j - k); i++) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+                        visit(Comparator{i + j, i + j + k});
+                    }
+                }
+            }
+        }
+    }
+}
+
+constexpr int count_odd_even_merge_sort_comparators(int n) noexcept {
+    int count = 0;
+    generate_odd_even_merge_sort(n, [&count](Comparator) { count++; });
+
+    return count;
+}
+
+template <int N>
+constexpr auto build_odd_even_merge_sort() noexcept {
+    std::array<Comparator, count_odd_even_merge_sort_comparators(N)> network{};
+
+    int count = 0;
+    generate_odd_even_merge_sort(N, [&network, &count](Comparator comparator) { network[count++] = comparator; });
+
+    return network;
+}
+
+// Sorts N keys from high to low using a sorting network, which is a fixed sequence of compare
+// and swaps. Each compare and swap compiles to a min and a max without branches, which suits
+// the short arrays sorted at every node better than std::sort.
+template <int N>
+class SortingNetwork {
+   public:
+    static_assert(N > 0, "A sorting network needs at least one key.");
+
+    static inline void sort(uint64_t *keys) noexcept { apply(keys, std::make_index_sequence<NETWORK.size()>{}); }
+
+    static constexpr int num_comparators() noexcept { return static_cast<int>(NETWORK.size()); }
+
+   private:
+    static constexpr auto NETWORK = build_odd_even_merge_sort<N>();
+
+    static inline void compare_and_swap(uint64_t &high, uint64_t &low) noexcept {
+        uint64_t a = high;
+        uint64_t b = low;
+
+        high = std::max(a, b);
+        low = std::min(a, b);
+    }
+
+    template <size_t... I>
+    static inline void apply([[maybe_unused]] uint64_t *keys, std::index_sequence<I...>) noexcept {
+        (compare_and_swap(keys[NETWORK[I].high], keys[NETWORK[I].low]), ...);
+    }
+};
+
+// Returns an unsigned integer which orders the same way as the score, including negative scores.
+// The sign bit is flipped for positive scores, and every bit is flipped for negative scores, as
+// their other bits grow as the score falls.
+inline uint32_t get_ordered_bits(float score) noexcept {
+    // Adding zero turns -0 into +0, so the two zeros are equal.
+    uint32_t bits = std::bit_cast<uint32_t>(score + 0.0f);
+
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+// Sorts the first num_cols columns from the highest to the lowest score, given by score_of(col).
+// Equal scores are ordered from the lowest column to the highest. Each score is packed into one
+// key with its column.
+template <int N, class ScoreOf>
+inline void sort_columns_by_score(int *cols, int num_cols, ScoreOf score_of) noexcept {
+    assert(0 <= num_cols && num_cols <= N);
+
+    // Unused keys are zero, which is below every packed key since the column part is never zero,
+    // so they sort to the end.
+    uint64_t keys[N]{};
+    for (int i = 0; i < num_cols; i++) {
+        assert(0 <= cols[i] && cols[i] < N);
+
+        keys[i] = (static_cast<uint64_t>(get_ordered_bits(score_of(cols[i]))) << 32) | static_cast<uint32_t>(N - cols[i]);
+    }
+
+    SortingNetwork<N>::sort(keys);
+
+    for (int i = 0; i < num_cols; i++) {
+        cols[i] = N - static_cast<int>(keys[i] & UINT32_MAX);
+    }
+}
+
+#endif
@@ -9,6 +9,8 @@ void Stats::merge(const Stats &other) {
     num_nodes += other.num_nodes;
     num_best_moves_guessed += other.num_best_moves_guessed;
     num_worst_moves_guessed += other.num_worst_moves_guessed;
+    num_minor_page_faults += other.num_minor_page_faults;
+    num_major_page_faults += other.num_major_page_faults;
 
     num_exact_nodes += other.num_exact_nodes;
     num_lower_nodes += other.num_lower_nodes;
@@ -16,6 +18,10 @@ void Stats::merge(const Stats &other) {
 
     num_lookup_success += other.num_lookup_success;
     num_lookup_miss += other.num_lookup_miss;
+    num_local_lookup_success += other.num_local_lookup_success;
+    num_local_lookup_miss += other.num_local_lookup_miss;
+    num_local_numa_lookups += other.num_local_numa_lookups;
+    num_remote_numa_lookups += other.num_remote_numa_lookups;
 
     num_store_entries += other.num_store_entries;
     num_store_overwrites += other.num_store_overwrites;
@@ -27,6 +33,8 @@ void Stats::reset() {
     num_nodes = 0;
     num_best_moves_guessed = 0;
     num_worst_moves_guessed = 0;
+    num_minor_page_faults = 0;
+    num_major_page_faults = 0;
 
     num_exact_nodes = 0;
     num_lower_nodes = 0;
@@ -34,6 +42,10 @@ void Stats::reset() {
 
     num_lookup_success = 0;
     num_lookup_miss = 0;
+    num_local_lookup_success = 0;
+    num_local_lookup_miss = 0;
+    num_local_numa_lookups = 0;
+    num_remote_numa_lookups = 0;
 
     num_store_entries = 0;
     num_store_overwrites = 0;
@@ -47,6 +59,11 @@ void Stats::completed_search(std::chrono::steady_clock::time_point search_start_
     this->search_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
 }
 
+void Stats::page_faults(unsigned long long minor, unsigned long long major) noexcept {
+    num_minor_page_faults += minor;
+    num_major_page_faults += major;
+}
+
 void Stats::new_interior_node(NodeType type) noexcept {
     switch (type) {
         case NodeType::EXACT:
@@ -81,9 +98,19 @@ std::string Stats::display_all_stats() const {
            << "    Total           = " << num_nodes << std::endl
            << "Table:" << std::endl
            << "    Hit rate        = " << get_hit_rate() * 100 << "%" << std::endl
+           << "    Local hit rate  = " << get_local_hit_rate() * 100 << "%" << std::endl
            << "    New write rate  = " << get_new_write_rate() * 100 << "%" << std::endl
            << "    Rewrite rate    = " << get_rewrite_rate() * 100 << "%" << std::endl
-           << "    Overwrite rate  = " << get_overwrite_rate() * 100 << "%" << std::endl
+           << "    Overwrite rate  = " << get_overwrite_rate() * 100 << "%" << std::endl;
+
+    if (ENABLE_NUMA_STATS) {
+        result << "    NUMA local rate = " << get_local_numa_rate() * 100 << "% of "
+               << num_local_numa_lookups + num_remote_numa_lookups << " sampled lookups" << std::endl;
+    }
+
+    result << "Page faults per s:" << std::endl
+           << "    Minor           = " << get_minor_page_faults_per_s() << std::endl
+           << "    Major           = " << get_major_page_faults_per_s() << std::endl
            << "Best moves guessed  = " << get_best_move_guess_rate() * 100 << "%" << std::endl
            << "Worst moves guessed = " << get_worst_move_guess_rate() * 100 << "%" << std::endl
            << std::endl;
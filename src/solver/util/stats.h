@@ -19,8 +19,13 @@ class Stats {
     double get_best_move_guess_rate() const noexcept { return (double)num_best_moves_guessed / get_num_interior_nodes(); }
     double get_worst_move_guess_rate() const noexcept { return (double)num_worst_moves_guessed / get_num_interior_nodes(); }
 
+    double get_minor_page_faults_per_s() const noexcept { return num_minor_page_faults * 1000.0 / std::max(1ULL, search_time_ms); }
+    double get_major_page_faults_per_s() const noexcept { return num_major_page_faults * 1000.0 / std::max(1ULL, search_time_ms); }
+
     // Lookup stats getters.
     double get_hit_rate() const noexcept { return (double)num_lookup_success / (num_lookup_success + num_lookup_miss); }
+    double get_local_numa_rate() const noexcept { return (double)num_local_numa_lookups / (num_local_numa_lookups + num_remote_numa_lookups); }
+    double get_local_hit_rate() const noexcept { return (double)num_local_lookup_success / (num_local_lookup_success + num_local_lookup_miss); }
 
     // Store stats getters.
     double get_new_write_rate() const noexcept { return (double)num_store_entries / get_num_stores(); }
@@ -30,6 +35,7 @@ class Stats {
     // Search stats increments.
     void completed_search(std::chrono::steady_clock::time_point search_start_time) noexcept;
     void new_node() noexcept { num_nodes++; }
+    void page_faults(unsigned long long minor, unsigned long long major) noexcept;
     void new_interior_node(NodeType type) noexcept;
 
     void best_move_guessed() noexcept { num_best_moves_guessed++; }
@@ -38,6 +44,9 @@ class Stats {
     // Lookup stats increments.
     void lookup_success() noexcept { num_lookup_success++; }
     void lookup_miss() noexcept { num_lookup_miss++; }
+    void local_lookup_success() noexcept { num_local_lookup_success++; }
+    void local_lookup_miss() noexcept { num_local_lookup_miss++; }
+    void numa_lookup(bool is_local) noexcept { (is_local) ? num_local_numa_lookups++ : num_remote_numa_lookups++; }
 
     // Store stats increments.
     void store_new_entry() noexcept { num_store_entries++; }
@@ -52,6 +61,8 @@ class Stats {
     unsigned long long num_nodes{0};
     unsigned long long num_best_moves_guessed{0};
     unsigned long long num_worst_moves_guessed{0};
+    unsigned long long num_minor_page_faults{0};
+    unsigned long long num_major_page_faults{0};
 
     // Type stats.
     unsigned long long num_exact_nodes{0};
@@ -61,6 +72,10 @@ class Stats {
     // Lookup stats.
     unsigned long long num_lookup_success{0};
     unsigned long long num_lookup_miss{0};
+    unsigned long long num_local_lookup_success{0};
+    unsigned long long num_local_lookup_miss{0};
+    unsigned long long num_local_numa_lookups{0};
+    unsigned long long num_remote_numa_lookups{0};
 
     // Store stats.
     unsigned long long num_store_entries{0};
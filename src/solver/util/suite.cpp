@@ -0,0 +1,27 @@
+#include "suite.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../position.h"
+
+std::vector<SuitePosition> read_suite(const std::filesystem::path &path, int max_positions) {
+    std::vector<SuitePosition> positions;
+
+    std::ifstream file(path);
+    std::string moves;
+    int score;
+
+    while ((int)positions.size() < max_positions && file >> moves >> score) {
+        Position pos{};
+        for (char move : moves) {
+            pos.move(move - '0');
+        }
+
+        positions.push_back({moves, pos, score});
+    }
+
+    return positions;
+}
@@ -0,0 +1,22 @@
+#ifndef SUITE_H_
+#define SUITE_H_
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../position.h"
+
+// A position from a test suite, with the moves played to reach it and its known score.
+struct SuitePosition {
+    std::string moves;
+    Position pos;
+    int score;
+};
+
+// Reads up to max_positions positions from a test suite. Each line of a suite has the columns
+// played from the empty board, followed by the score of the position. Returns no positions if
+// the suite cannot be read.
+std::vector<SuitePosition> read_suite(const std::filesystem::path &path, int max_positions);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+
+This program tunes the weights used to order moves, by searching for the weights which solve
+a test suite in the fewest nodes. Run it with the test suite, and optionally the number of
+positions to solve from the suite and the maximum number of passes over the weights:
+
+    tune tst/data/7x6/midgame_L2.txt 1000 10
+
+The search is a coordinate descent. Each weight in turn is moved up and down by its step, and
+the change is kept if fewer nodes were searched. Once a pass over every weight finds no
+improvement, all steps are halved. The weights with the fewest nodes are printed at the end.
+
+Nodes are only comparable between runs with the same table size and number of threads. The
+jitter weight is only tuned with more than one thread, since it has no effect otherwise.
+
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "solver/position.h"
+#include "solver/search.h"
+#include "solver/solver.h"
+#include "solver/util/suite.h"
+
+static inline constexpr int DEFAULT_POSITIONS = 200;
+static inline constexpr int DEFAULT_PASSES = 8;
+
+// Stop once every step has been halved this many times.
+static inline constexpr int MAX_STEP_HALVINGS = 3;
+
+struct TunedWeight {
+    const char *name;
+    float HeuristicWeights::*weight;
+    float step;
+};
+
+static const std::vector<TunedWeight> TUNED_WEIGHTS = {
+    {"next_turn_threats", &HeuristicWeights::next_turn_threats, 0.2f},
+    {"next_next_turn_threats", &HeuristicWeights::next_next_turn_threats, 0.2f},
+    {"threats", &HeuristicWeights::threats, 0.1f},
+    {"table_move", &HeuristicWeights::table_move, 0.2f},
+    {"center", &HeuristicWeights::center, 0.05f},
+    {"killer_move", &HeuristicWeights::killer_move, 0.005f},
+    {"history", &HeuristicWeights::history, 0.005f},
+    {"jitter", &HeuristicWeights::jitter, 0.1f},
+};
+
+static void print_weights(std::ostream &out, const HeuristicWeights &weights) {
+    for (const TunedWeight &tuned : TUNED_WEIGHTS) {
+        out << " " << tuned.name << "=" << weights.*tuned.weight;
+    }
+}
+
+// Returns the number of nodes searched to solve every position, starting from an empty table.
+static unsigned long long count_nodes(Solver &solver, const HeuristicWeights &weights,
+        const std::vector<SuitePosition> &positions) {
+    solver.clear_state();
+    solver.set_heuristic_weights(weights);
+
+    for (const SuitePosition &position : positions) {
+        int score = solver.solve_strong(position.pos);
+
+        if (score != position.score) {
+            std::cerr << "Error: the solver returned " << score << " instead of " << position.score
+                      << " with weights";
+            print_weights(std::cerr, weights);
+            std::cerr << "." << std::endl;
+            std::exit(1);
+        }
+    }
+
+    return solver.get_merged_stats().get_num_nodes();
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <test suite> [positions] [passes]" << std::endl;
+        return 1;
+    }
+
+    int max_positions = (argc > 2) ? std::stoi(argv[2]) : DEFAULT_POSITIONS;
+    int max_passes = (argc > 3) ? std::stoi(argv[3]) : DEFAULT_PASSES;
+
+    std::vector<SuitePosition> positions = read_suite(argv[1], max_positions);
+    if (positions.empty()) {
+        std::cerr << "No positions found in " << argv[1] << "." << std::endl;
+        return 1;
+    }
+
+    Solver solver{};
+    std::cout.imbue(std::locale(""));
+    std::cout << solver.get_settings_string() << "Tuning on " << positions.size() << " positions from "
+              << argv[1] << "." << std::endl
+              << std::endl;
+
+    HeuristicWeights best{};
+    unsigned long long best_nodes = count_nodes(solver, best, positions);
+    unsigned long long default_nodes = best_nodes;
+
+    std::cout << std::setw(16) << best_nodes << " nodes with the default weights" << std::endl;
+
+    std::vector<float> steps;
+    for (const TunedWeight &tuned : TUNED_WEIGHTS) {
+        steps.push_back(tuned.step);
+    }
+
+    int num_halvings = 0;
+    for (int pass = 0; pass < max_passes && num_halvings <= MAX_STEP_HALVINGS; pass++) {
+        bool improved = false;
+
+        for (size_t i = 0; i < TUNED_WEIGHTS.size(); i++) {
+            const TunedWeight &tuned = TUNED_WEIGHTS[i];
+            if (tuned.weight == &HeuristicWeights::jitter && solver.get_num_threads() == 1) {
+                continue;
+            }
+
+            for (float direction : {1.0f, -1.0f}) {
+                HeuristicWeights candidate = best;
+
+                candidate.*tuned.weight = best.*tuned.weight + direction * steps[i];
+
+                // The jitter is the size of the noise added to scores, and is also the margin by
+                // which a score must stand apart from its neighbours to keep the noise, so it
+                // cannot be negative. The other weights can be.
+                if (tuned.weight == &HeuristicWeights::jitter) {
+                    candidate.jitter = std::max(0.0f, candidate.jitter);
+                }
+                if (candidate.*tuned.weight == best.*tuned.weight) {
+                    continue;
+                }
+
+                unsigned long long nodes = count_nodes(solver, candidate, positions);
+                std::cout << std::setw(16) << nodes << " nodes with " << tuned.name << "="
+                          << candidate.*tuned.weight << std::endl;
+
+                if (nodes < best_nodes) {
+                    best = candidate;
+                    best_nodes = nodes;
+                    improved = true;
+
+                    // No need to try the other direction.
+                    break;
+                }
+            }
+        }
+
+        if (!improved) {
+            for (float &step : steps) {
+                step /= 2;
+            }
+
+            num_halvings++;
+        }
+
+        std::cout << "After pass " << pass + 1 << ":";
+        print_weights(std::cout, best);
+        std::cout << std::endl;
+    }
+
+    std::cout << std::endl
+              << "Best weights:";
+    print_weights(std::cout, best);
+    std::cout << std::endl
+              << std::setw(16) << best_nodes << " nodes, " << std::fixed << std::setprecision(2)
+              << 100.0 * ((double)best_nodes - (double)default_nodes) / (double)default_nodes
+              << "% compared to the default weights." << std::endl;
+
+    return 0;
+}
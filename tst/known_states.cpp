@@ -1,9 +1,11 @@
 #include "known_states.h"
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -104,9 +106,11 @@ bool self_play_test(Solver &solver, struct test_data test_data) {
     }
 
     // Play the game until it is over, checking that the game is proceeding as predicted at each turn.
+    // Each search starts from the negated score of the last position, as in a game.
+    std::optional<int> guess;
     int moves_played;
     for (moves_played = 0; !pos.is_game_over(); moves_played++) {
-        int score = solver.solve_strong(pos);
+        int score = solver.solve_strong(pos, guess);
         int move = pv[moves_played];
 
         // Fail if the solver outputted an invalid move.
@@ -128,6 +132,7 @@ bool self_play_test(Solver &solver, struct test_data test_data) {
 
         pos.move(move);
         expected_score = -expected_score;
+        guess = -score;
     }
 
     // Fail if number of moves played does not match the prediction.
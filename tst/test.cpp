@@ -5,6 +5,7 @@
 #include "../src/solver/solver.h"
 #include "known_states.h"
 #include "test_position.h"
+#include "test_sorting_network.h"
 #include "test_table.h"
 #include "unit_test.h"
 
@@ -19,6 +20,7 @@ static bool all_tests_successful(Solver &solver, bool light_mode) {
     std::cout << "Running unit tests . . ." << std::endl;
     run_test(all_position_tests());
     run_test(all_table_tests());
+    run_test(all_sorting_network_tests());
 
     // Test against states with known scores.
     std::cout << "Running known state tests . . ." << std::endl;
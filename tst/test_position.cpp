@@ -394,6 +394,53 @@ static bool test_is_move_valid() {
     return true;
 }
 
+static bool test_find_move_threats_matches_threats_after_each_move_on_random_games() {
+    // Reset the random number sequence.
+    srand(0);
+
+    for (int trial = 0; trial < 10 * 1000; trial++) {
+        Position pos{};
+
+        // Play random moves until either player could win this move, or the game is a draw.
+        while (!pos.is_draw() && !pos.wins_this_move(pos.find_player_threats())
+                && !pos.wins_this_move(pos.find_opponent_threats())) {
+            int moves[BOARD_WIDTH];
+            int num_moves = 0;
+            for (int col = 0; col < BOARD_WIDTH; col++) {
+                if (pos.is_move_valid(col)) {
+                    moves[num_moves++] = col;
+                }
+            }
+
+            board opponent_threats = pos.find_opponent_threats();
+            MoveThreats move_threats[BOARD_WIDTH];
+            pos.find_move_threats(opponent_threats, num_moves, moves, move_threats);
+
+            // Compare against the threats found after playing each move.
+            for (int i = 0; i < num_moves; i++) {
+                Position child = pos;
+                child.move(moves[i]);
+
+                // Threats are not defined once the board is full.
+                if (child.is_draw()) {
+                    continue;
+                }
+
+                board threats = child.find_useful_threats(child.find_opponent_threats(), opponent_threats);
+                expect_true("useful threats after the move", move_threats[i].useful == threats);
+                expect_true("threats playable next turn",
+                    move_threats[i].next_turn == child.find_next_turn_threats(threats));
+                expect_true("threats playable the turn after",
+                    move_threats[i].next_next_turn == child.find_next_next_turn_threats(threats));
+            }
+
+            pos.move(get_random_move(pos));
+        }
+    }
+
+    return true;
+}
+
 static bool test_mirror_hash_on_random_games() {
     // Reset the random number sequence.
     srand(0);
@@ -411,6 +458,7 @@ static bool test_mirror_hash_on_random_games() {
 
             bool is_mirrored_1, is_mirrored_2;
             expect_true("mirrored hashes must be equal", pos.hash(is_mirrored_1) == mirror.hash(is_mirrored_2));
+            expect_true("only one of a non symmetric pair is mirrored", !is_mirrored_1 || !is_mirrored_2);
         }
     }
 
@@ -517,6 +565,8 @@ bool all_position_tests() {
 
     run_test(test_is_move_valid());
 
+    run_test(test_find_move_threats_matches_threats_after_each_move_on_random_games());
+
     run_test(test_mirror_hash_on_random_games());
 
     run_test(test_find_dead_stones_returns_subset_of_dead_stones_on_random_games());
@@ -0,0 +1,74 @@
+#include "test_sorting_network.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+#include "../src/solver/settings.h"
+#include "../src/solver/util/sorting_network.h"
+#include "unit_test.h"
+
+// Sorts the columns the way the sorting network should, from the highest to the lowest score,
+// with equal scores from the lowest column to the highest.
+static void sort_columns_by_score_reference(int *cols, int num_cols, const float *scores) {
+    std::sort(cols, cols + num_cols);
+    std::stable_sort(cols, cols + num_cols, [scores](int a, int b) { return scores[a] > scores[b]; });
+}
+
+static bool test_sorting_network_orders_ties_and_signed_scores() {
+    int cols[] = {3, 0, 2, 1};
+
+    // Equal scores are ordered by column, and both zeros are equal.
+    const float scores[] = {-0.0f, 0.0f, -0.0f, 0.0f};
+    sort_columns_by_score<4>(cols, 4, [&scores](int col) { return scores[col]; });
+    expect_true("zeros are ordered by column", cols[0] == 0 && cols[1] == 1 && cols[2] == 2 && cols[3] == 3);
+
+    // Negative scores are ordered below smaller negative scores, and below positive scores.
+    const float signed_scores[] = {-2.0f, 1.5f, -0.5f, -3.0f};
+    sort_columns_by_score<4>(cols, 4, [&signed_scores](int col) { return signed_scores[col]; });
+    expect_true("negative scores are ordered", cols[0] == 1 && cols[1] == 2 && cols[2] == 0 && cols[3] == 3);
+
+    return true;
+}
+
+static bool test_sorting_network_matches_stable_sort_on_random_scores() {
+    // Few distinct scores, so most arrays have ties, including between the two zeros.
+    const float values[] = {-3.0f, -1.5f, -0.25f, -0.0f, 0.0f, 0.25f, 1.5f, 3.0f};
+
+    std::mt19937 rand{0};
+    std::uniform_int_distribution<int> pick_value{0, static_cast<int>(std::size(values)) - 1};
+
+    for (int num_cols = 1; num_cols <= BOARD_WIDTH; num_cols++) {
+        for (int trial = 0; trial < 10 * 1000; trial++) {
+            float scores[BOARD_WIDTH];
+            for (float &score : scores) {
+                score = values[pick_value(rand)];
+            }
+
+            // Pick num_cols different columns in a random order.
+            int all_cols[BOARD_WIDTH];
+            std::iota(all_cols, all_cols + BOARD_WIDTH, 0);
+            std::shuffle(all_cols, all_cols + BOARD_WIDTH, rand);
+
+            int actual[BOARD_WIDTH];
+            int expected[BOARD_WIDTH];
+            std::copy(all_cols, all_cols + num_cols, actual);
+            std::copy(all_cols, all_cols + num_cols, expected);
+
+            sort_columns_by_score<BOARD_WIDTH>(actual, num_cols, [&scores](int col) { return scores[col]; });
+            sort_columns_by_score_reference(expected, num_cols, scores);
+
+            expect_true("sorting network matches a stable sort", std::equal(actual, actual + num_cols, expected));
+        }
+    }
+
+    return true;
+}
+
+bool all_sorting_network_tests() {
+    run_test(test_sorting_network_orders_ties_and_signed_scores());
+    run_test(test_sorting_network_matches_stable_sort_on_random_scores());
+
+    return true;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_SORTING_NETWORK_H_
+#define TEST_SORTING_NETWORK_H_
+
+bool all_sorting_network_tests();
+
+#endif
@@ -1,14 +1,29 @@
 #include "test_table.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
 
+#include "../src/solver/local_table.h"
 #include "../src/solver/position.h"
 #include "../src/solver/table.h"
+#include "../src/solver/util/fastmod.h"
 #include "unit_test.h"
 
+// Returns the given table size, raised on large boards to leave room for more than the minimum
+// number of buckets the board needs.
+static uint64_t get_table_size(uint64_t num_bytes) {
+    return std::max<uint64_t>(num_bytes, 2 * Entry::min_num_buckets() * sizeof(Bucket));
+}
+
 static bool test_table_lookup_returns_stored_results() {
     Position pos1{};
-    Table table{};
+    Table table{64 * 1024 * 1024};
 
     int counter = 0;
     bool is_mirrored;
@@ -44,6 +59,327 @@ static bool test_table_lookup_returns_stored_results() {
     return true;
 }
 
+static bool test_table_bucket_keeps_entries_with_most_work() {
+    Table table{64 * 1024 * 1024};
+
+    // All of these hashes map to the same bucket.
+    uint64_t num_buckets = table.get_num_buckets();
+    auto bucket_hash = [num_buckets](int i) { return static_cast<board>(1 + i * num_buckets); };
+
+    // Fill the bucket, with the work of each entry increasing.
+    for (int i = 0; i < ENTRIES_PER_BUCKET; i++) {
+        table.put(bucket_hash(i), false, 0, NodeType::EXACT, 0, 1ull << (3 * i + 3));
+    }
+
+    for (int i = 0; i < ENTRIES_PER_BUCKET; i++) {
+        expect_true("every entry in a full bucket is found", table.get(bucket_hash(i)).get_type() == NodeType::EXACT);
+    }
+
+    // One more position must evict the entry with the least work.
+    table.put(bucket_hash(ENTRIES_PER_BUCKET), false, 0, NodeType::LOWER, 0, 1);
+
+    expect_true("new entry is stored", table.get(bucket_hash(ENTRIES_PER_BUCKET)).get_type() == NodeType::LOWER);
+    expect_true("least work entry is evicted", table.get(bucket_hash(0)).get_type() == NodeType::MISS);
+    for (int i = 1; i < ENTRIES_PER_BUCKET; i++) {
+        expect_true("other entries are kept", table.get(bucket_hash(i)).get_type() == NodeType::EXACT);
+    }
+
+    return true;
+}
+
+static bool test_table_replacement_policies_choose_entry_to_evict() {
+    BasicTable<ExactPreferred> exact_table{get_table_size(1024 * 1024)};
+    BasicTable<AlwaysReplace> always_table{get_table_size(1024 * 1024)};
+
+    // All of these hashes map to the same bucket.
+    uint64_t num_buckets = exact_table.get_num_buckets();
+    auto bucket_hash = [num_buckets](int i) { return static_cast<board>(1 + i * num_buckets); };
+
+    // Fill the bucket with one cheap exact entry, and bounds which took more work.
+    exact_table.put(bucket_hash(0), false, 0, NodeType::EXACT, 0, 1);
+    always_table.put(bucket_hash(0), false, 0, NodeType::EXACT, 0, 1ull << 15);
+    for (int i = 1; i < ENTRIES_PER_BUCKET; i++) {
+        exact_table.put(bucket_hash(i), false, 0, NodeType::LOWER, 0, 1ull << (3 * i + 3));
+        always_table.put(bucket_hash(i), false, 0, NodeType::LOWER, 0, 1ull << (3 * i + 3));
+    }
+
+    exact_table.put(bucket_hash(ENTRIES_PER_BUCKET), false, 0, NodeType::UPPER, 0, 1);
+    always_table.put(bucket_hash(ENTRIES_PER_BUCKET), false, 0, NodeType::UPPER, 0, 1);
+
+    expect_true("exact entry is kept over bounds", exact_table.get(bucket_hash(0)).get_type() == NodeType::EXACT);
+    expect_true("bound with least work is evicted", exact_table.get(bucket_hash(1)).get_type() == NodeType::MISS);
+    expect_true("entry is replaced regardless of work", always_table.get(bucket_hash(0)).get_type() == NodeType::MISS);
+    expect_true("new entry is stored", always_table.get(bucket_hash(ENTRIES_PER_BUCKET)).get_type() == NodeType::UPPER);
+
+    return true;
+}
+
+static bool test_table_bucket_evicts_entries_from_old_epochs() {
+    Table table{64 * 1024 * 1024};
+
+    // All of these hashes map to the same bucket.
+    uint64_t num_buckets = table.get_num_buckets();
+    auto bucket_hash = [num_buckets](int i) { return static_cast<board>(1 + i * num_buckets); };
+
+    // Fill the bucket with expensive results from an earlier search.
+    for (int i = 0; i < ENTRIES_PER_BUCKET; i++) {
+        table.put(bucket_hash(i), false, 0, NodeType::EXACT, 0, 1ull << 15);
+    }
+
+    for (int epoch = 0; epoch < 3; epoch++) {
+        table.next_epoch();
+    }
+
+    // Using an entry in the current epoch should protect it.
+    expect_true("old entry is found", table.get(bucket_hash(0)).get_type() == NodeType::EXACT);
+
+    // Cheap results from the current search replace the old unused entries.
+    for (int i = ENTRIES_PER_BUCKET; i < 2 * ENTRIES_PER_BUCKET - 1; i++) {
+        table.put(bucket_hash(i), false, 0, NodeType::LOWER, 0, 1);
+    }
+
+    expect_true("used entry is kept", table.get(bucket_hash(0)).get_type() == NodeType::EXACT);
+    for (int i = 1; i < ENTRIES_PER_BUCKET; i++) {
+        expect_true("unused old entries are evicted", table.get(bucket_hash(i)).get_type() == NodeType::MISS);
+    }
+    for (int i = ENTRIES_PER_BUCKET; i < 2 * ENTRIES_PER_BUCKET - 1; i++) {
+        expect_true("new entries are stored", table.get(bucket_hash(i)).get_type() == NodeType::LOWER);
+    }
+
+    return true;
+}
+
+// A uniquely named file in the temporary directory, so concurrent test runs do not share it.
+// The file is removed when the test returns, including when a check fails.
+class TempFile {
+   public:
+    explicit TempFile(const std::string &prefix) {
+        std::random_device device;
+        std::uniform_int_distribution<uint64_t> dist;
+
+        path = std::filesystem::temp_directory_path() / (prefix + "-" + std::to_string(dist(device)) + ".bin");
+    }
+
+    ~TempFile() {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+
+    const std::filesystem::path &get_path() const { return path; }
+
+   private:
+    std::filesystem::path path;
+};
+
+static bool test_table_snapshot_restores_entries() {
+    TempFile file{"c4-test-snapshot"};
+    const std::filesystem::path &path = file.get_path();
+
+    Table saved{4 * get_table_size(1024 * 1024)};
+    for (int i = 1; i <= 1000; i++) {
+        saved.put(i * 7919, false, i % BOARD_WIDTH, NodeType::LOWER, i % Position::MAX_SCORE, i);
+    }
+    expect_true("snapshot is saved", saved.save_snapshot(path));
+
+    // The restored table takes the size of the snapshot.
+    Table restored{get_table_size(1024 * 1024)};
+    expect_true("snapshot is loaded", restored.load_snapshot(path));
+    expect_true("restored table has the saved size", restored.get_num_buckets() == saved.get_num_buckets());
+
+    for (int i = 1; i <= 1000; i++) {
+        Entry entry = restored.get(i * 7919);
+        expect_true("restored entries have the saved type", entry.get_type() == NodeType::LOWER);
+        expect_true("restored entries have the saved move", entry.get_move(false) == i % BOARD_WIDTH);
+        expect_true("restored entries have the saved score", entry.get_score() == i % Position::MAX_SCORE);
+    }
+
+    // Changes to a restored table are not written back to the snapshot.
+    restored.clear();
+    Table reloaded{get_table_size(1024 * 1024)};
+    expect_true("snapshot is loaded again", reloaded.load_snapshot(path));
+    expect_true("snapshot is unchanged", reloaded.get(7919).get_type() == NodeType::LOWER);
+
+    // Files which are not snapshots are rejected.
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a snapshot";
+    Table rejected{get_table_size(1024 * 1024)};
+    uint64_t num_buckets = rejected.get_num_buckets();
+    expect_true("invalid snapshot is rejected", !rejected.load_snapshot(path));
+    expect_true("table is unchanged by an invalid snapshot", rejected.get_num_buckets() == num_buckets);
+
+    return true;
+}
+
+static bool test_file_backed_table_stores_and_clears_entries() {
+    Table table{get_table_size(4 * 1024 * 1024), std::filesystem::temp_directory_path()};
+    expect_true("table is backed by a file", table.is_file_backed());
+
+    for (int i = 1; i <= 1000; i++) {
+        table.put(i * 7919, false, i % BOARD_WIDTH, NodeType::UPPER, i % Position::MAX_SCORE, i);
+    }
+
+    for (int i = 1; i <= 1000; i++) {
+        Entry entry = table.get(i * 7919);
+        expect_true("file backed entries have the stored type", entry.get_type() == NodeType::UPPER);
+        expect_true("file backed entries have the stored move", entry.get_move(false) == i % BOARD_WIDTH);
+        expect_true("file backed entries have the stored score", entry.get_score() == i % Position::MAX_SCORE);
+    }
+
+    // Clear the table in uneven parts, so parts do not start or end on a page boundary.
+    for (int part = 0; part < 3; part++) {
+        table.clear(part, 3);
+    }
+
+    for (int i = 1; i <= 1000; i++) {
+        expect_true("file backed entries are cleared", table.get(i * 7919).get_type() == NodeType::MISS);
+    }
+
+    return true;
+}
+
+static bool test_entry_layout_matches_board_size() {
+    // The 4x7 test build is the only one which packs entries into 32 bits.
+    if constexpr (BOARD_WIDTH == 4 && BOARD_HEIGHT == 7) {
+        expect_true("4x7 entries are compact", Entry::is_compact() && sizeof(Entry) == 4);
+    } else if constexpr (BOARD_WIDTH == 7 && BOARD_HEIGHT == 6) {
+        expect_true("7x6 entries store both bounds", !Entry::is_compact() && Entry::stores_both_bounds());
+    }
+
+    return true;
+}
+
+static bool test_table_merges_bounds_of_the_same_position() {
+    Table table{get_table_size(1024 * 1024)};
+
+    table.put(7919, false, 2, NodeType::LOWER, -3, 100);
+    table.put(7919, false, 3, NodeType::UPPER, 5, 10);
+    Entry entry = table.get(7919);
+
+    if constexpr (Entry::stores_both_bounds()) {
+        expect_true("lower bound is kept", entry.get_lower_bound() == -3);
+        expect_true("upper bound is merged", entry.get_upper_bound() == 5);
+        expect_true("move of the lower bound is kept", entry.get_move(false) == 2);
+        expect_true("merged bounds are a lower bound", entry.get_type() == NodeType::LOWER);
+
+        table.put(7919, false, 1, NodeType::LOWER, 5, 10);
+        expect_true("meeting bounds are exact", table.get(7919).get_type() == NodeType::EXACT);
+        expect_true("meeting bounds give the score", table.get(7919).get_score() == 5);
+    } else {
+        expect_true("newer bound replaces the old bound", entry.get_type() == NodeType::UPPER);
+        expect_true("lower bound is unknown", entry.get_lower_bound() == Position::MIN_SCORE);
+        expect_true("upper bound is stored", entry.get_upper_bound() == 5);
+    }
+
+    return true;
+}
+
+static bool test_local_table_returns_stored_results() {
+    LocalTable table{std::make_shared<Stats>()};
+
+    for (int i = 1; i <= 100; i++) {
+        table.put(i * 7919, i % 2 == 0, i % BOARD_WIDTH, NodeType::LOWER, i % Position::MAX_SCORE, i);
+    }
+
+    for (int i = 1; i <= 100; i++) {
+        Entry entry = table.get(i * 7919);
+        expect_true("local entries have the stored type", entry.get_type() == NodeType::LOWER);
+        expect_true("local entries have the stored move", entry.get_move(i % 2 == 0) == i % BOARD_WIDTH);
+        expect_true("local entries have the stored score", entry.get_score() == i % Position::MAX_SCORE);
+    }
+
+    // The full hash is compared, so hashes which only differ in their high bits are not confused.
+    board high_bit = static_cast<board>(1) << (8 * sizeof(board) - 1);
+    expect_true("local table compares the full hash", table.get(high_bit | 7919).get_type() == NodeType::MISS);
+
+    table.clear();
+    expect_true("local table is cleared", table.get(7919).get_type() == NodeType::MISS);
+
+    return true;
+}
+
+static bool test_local_table_keeps_exact_entries() {
+    LocalTable table{std::make_shared<Stats>()};
+
+    // Later bounds of the same position must not replace an exact score, even on boards
+    // where entries only store a single bound.
+    table.put(7919, false, 1, NodeType::EXACT, 2, 100);
+    table.put(7919, false, 3, NodeType::LOWER, 1, 200);
+    table.put(7919, false, 0, NodeType::UPPER, 5, 300);
+
+    Entry entry = table.get(7919);
+    expect_true("local exact entry keeps its type", entry.get_type() == NodeType::EXACT);
+    expect_true("local exact entry keeps its score", entry.get_score() == 2);
+    expect_true("local exact entry keeps its move", entry.get_move(false) == 1);
+
+    return true;
+}
+
+static bool test_table_size_fits_in_memory() {
+    // The table size settings are ignored when the number of buckets is fixed.
+    if (FIXED_TABLE_BUCKETS != 0) {
+        return true;
+    }
+
+    const uint64_t sizes[] = {get_table_size(1024 * 1024), get_table_size(64 * 1024 * 1024) + 100};
+
+    for (uint64_t num_bytes : sizes) {
+        Table table{num_bytes};
+        uint64_t num_buckets = table.get_num_buckets();
+
+        expect_true("number of buckets is odd", num_buckets % 2 == 1);
+        expect_true("table fits in the requested memory", num_buckets * sizeof(Bucket) <= num_bytes);
+        expect_true("table uses most of the requested memory", num_buckets * sizeof(Bucket) > num_bytes * 0.99);
+    }
+
+    return true;
+}
+
+static bool test_table_smaller_than_minimum_is_rejected() {
+    // The table size settings are ignored when the number of buckets is fixed, and tables are
+    // grown to the minimum size if asked to.
+    if (FIXED_TABLE_BUCKETS != 0 || std::getenv("C4_TABLE_GROW")) {
+        return true;
+    }
+
+    uint64_t min_bytes = std::max<uint64_t>(Entry::min_num_buckets(), 3) * sizeof(Bucket);
+
+    bool is_rejected = false;
+    try {
+        Table table{min_bytes - sizeof(Bucket)};
+    } catch (const std::runtime_error &) {
+        is_rejected = true;
+    }
+    expect_true("table smaller than the minimum is rejected", is_rejected);
+
+    return true;
+}
+
+static bool test_fast_mod_matches_remainder() {
+    // (2 * 2^64) % 0xAAAAAAAAAAAAAAAB is above 2^63, so on boards with high words of 2 or more
+    // adding the reduced high word to the low word overflows 64 bits.
+    const uint64_t divisors[] = {1, 3, 1048583, 16777213, 905969671, 4294967311, 0xAAAAAAAAAAAAAAAB, 0xFFFFFFFFFFFFFFC5};
+
+    std::mt19937_64 rand{0};
+
+    for (uint64_t divisor : divisors) {
+        FastMod fast_mod{divisor};
+
+        for (int i = 0; i < 10000; i++) {
+            uint64_t n = (i < 2) ? i * UINT64_MAX : rand();
+            expect_true("64 bit fast mod equals remainder", fast_mod.mod(n) == n % divisor);
+
+#ifdef __SIZEOF_INT128__
+            __uint128_t narrow = (static_cast<__uint128_t>(rand() & 0xFF) << 64) | rand();
+            expect_true("72 bit fast mod equals remainder", fast_mod.mod(narrow) == narrow % divisor);
+
+            __uint128_t wide = (static_cast<__uint128_t>(rand()) << 64) | rand();
+            expect_true("128 bit fast mod equals remainder", fast_mod.mod(wide) == wide % divisor);
+#endif
+        }
+    }
+
+    return true;
+}
+
 static bool test_hash_state_returns_equal_hash_for_equal_states() {
     Position pos1{};
 
@@ -76,8 +412,8 @@ static bool test_hash_state_returns_equal_hash_for_mirrored_state() {
     pos1.move(0); pos1.move(1);
     pos1.move(2); pos1.move(3);
     pos1.move(2); pos1.move(3);
-    pos1.move(4); pos1.move(4);
-    pos1.move(5); pos1.move(5);
+    pos1.move(0); pos1.move(0);
+    pos1.move(1); pos1.move(1);
 
     bool is_mirrored_1;
     board expected = pos1.hash(is_mirrored_1);
@@ -89,8 +425,8 @@ static bool test_hash_state_returns_equal_hash_for_mirrored_state() {
     pos2.move(BOARD_WIDTH - 1); pos2.move(BOARD_WIDTH - 2);
     pos2.move(BOARD_WIDTH - 3); pos2.move(BOARD_WIDTH - 4);
     pos2.move(BOARD_WIDTH - 3); pos2.move(BOARD_WIDTH - 4);
-    pos2.move(BOARD_WIDTH - 5); pos2.move(BOARD_WIDTH - 5);
-    pos2.move(BOARD_WIDTH - 6); pos2.move(BOARD_WIDTH - 6);
+    pos2.move(BOARD_WIDTH - 1); pos2.move(BOARD_WIDTH - 1);
+    pos2.move(BOARD_WIDTH - 2); pos2.move(BOARD_WIDTH - 2);
 
     bool is_mirrored_2;
     board actual = pos2.hash(is_mirrored_2);
@@ -135,6 +471,18 @@ static bool test_hash_state_returns_equal_hash_for_states_with_dead_stones() {
 
 bool all_table_tests() {
     run_test(test_table_lookup_returns_stored_results());
+    run_test(test_table_bucket_keeps_entries_with_most_work());
+    run_test(test_table_replacement_policies_choose_entry_to_evict());
+    run_test(test_table_bucket_evicts_entries_from_old_epochs());
+    run_test(test_table_snapshot_restores_entries());
+    run_test(test_file_backed_table_stores_and_clears_entries());
+    run_test(test_entry_layout_matches_board_size());
+    run_test(test_table_merges_bounds_of_the_same_position());
+    run_test(test_local_table_returns_stored_results());
+    run_test(test_local_table_keeps_exact_entries());
+    run_test(test_table_size_fits_in_memory());
+    run_test(test_table_smaller_than_minimum_is_rejected());
+    run_test(test_fast_mod_matches_remainder());
 
     run_test(test_hash_state_returns_equal_hash_for_equal_states());
     run_test(test_hash_state_returns_equal_hash_for_mirrored_state());